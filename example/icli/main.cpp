@@ -1,5 +1,6 @@
 #include <vector>
 #include <memory>
+#include <filesystem>
 #include "Arch/icli.h"
 
 int main() {
@@ -8,6 +9,13 @@ int main() {
       {
        std::make_shared<CLI_PromptInput>("Enter your name:"),
        std::make_shared<CLI_PromptInput>("Enter your name:", "default"),
+       std::make_shared<CLI_PromptInput>(
+           "Project directory:", ".",
+           [](const std::string &path, const ValidationToken &) {
+             return std::filesystem::is_directory(path)
+                        ? std::string()
+                        : "No such directory: " + path;
+           }),
        std::make_shared<CLI_PromptContinue>("Do you want to continue?"),
        std::make_shared<CLI_PromptBoolean>("Yes or No?"),
        std::make_shared<CLI_PromptSingleSelect>(
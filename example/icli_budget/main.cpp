@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "Arch/icli.h"
+#include "Arch/icli/profile_counters.h"
+
+/*
+ * Per-keystroke budget check for the render path.
+ *
+ *   example_icli_budget [-v]
+ *
+ * Drives each prompt type through a scripted session over a socketpair.
+ * After a warm-up, every keystroke is measured from reading the input to
+ * the repainted frame leaving the writer: heap allocations (the program
+ * links arch_icli_alloc_count), write syscalls and termios calls. Exits
+ * non-zero when a keystroke goes over its prompt's budget, so a change
+ * that makes the render path allocate more or write more than one frame
+ * per keystroke fails when this is run after a build. -v prints the
+ * worst keystroke of each prompt.
+ */
+
+struct Budget {
+  uint64_t allocations; // 每次按键的上限
+  uint64_t writes;      // 至多一帧；画面不变时不写
+};
+
+struct Case {
+  const char *name;
+  std::function<std::shared_ptr<CLI_PROMPT>()> make;
+  std::vector<std::string> warmup;
+  std::vector<std::string> keys; // 逐个计量
+  Budget budget;
+};
+
+static std::string table_cell(size_t row, size_t column) {
+  return column == 0 ? "package-" + std::to_string(row) : std::to_string(row * 37 % 1000);
+}
+
+static std::vector<Case> cases() {
+  const std::string up = "\033[A", down = "\033[B", left = "\033[D", right = "\033[C";
+  const std::string shiftDown = "\033[1;2B", pageDown = "\033[6~";
+
+  std::vector<Option> few, many;
+  for (int i = 0; i < 40; ++i)
+    few.emplace_back("Option " + std::to_string(i),
+                     "Description of option " + std::to_string(i) +
+                         ", long enough to be wrapped over more than one line of the panel");
+  for (int i = 0; i < 20000; ++i)
+    many.emplace_back("target-" + std::to_string(i));
+
+  return {
+      {"Input", [] { return std::make_shared<CLI_PromptInput>("Name:"); },
+       {"warm", "\x7f\x7f\x7f\x7f"},
+       {"h", "e", "l", "l", "o", "\x7f", "\x7f", left, right},
+       {4, 1}},
+      {"Boolean", [] { return std::make_shared<CLI_PromptBoolean>("Proceed?"); },
+       {right, left},
+       {right, left, right, left},
+       {6, 1}},
+      {"Continue", [] { return std::make_shared<CLI_PromptContinue>("Continue?"); },
+       {right, left},
+       {right, left, right, left},
+       {6, 1}},
+      {"SingleSelect",
+       [few] { return std::make_shared<CLI_PromptSingleSelect>("Pick one", few); },
+       {down, up},
+       {down, down, down, down, down, down, down, down, down, down, down, down, up, up},
+       {40, 1}},
+      {"MultiSelect",
+       [many] { return std::make_shared<CLI_PromptMultiSelect>("Targets", many); },
+       {down, " ", up},
+       {" ", down, " ", shiftDown, shiftDown, "a", "i", "n", down, down, down,
+        down, down, down, down, down, down, down, down, up},
+       {24, 1}},
+      {"Table",
+       [] {
+         return std::make_shared<CLI_PromptTable>(
+             "Package", std::vector<TableColumn>{TableColumn("Name"), TableColumn("Score", 0, true)},
+             1000000, table_cell);
+       },
+       {down, up},
+       {down, down, down, down, down, down, down, down, down, down, down, down,
+        pageDown, up},
+       {40, 1}},
+  };
+}
+
+// 读走会话的输出，像终端一样应答光标位置查询
+static void drain(int fd) {
+  char buf[65536];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    const std::string out(buf, static_cast<size_t>(n));
+    for (size_t at = out.find("\033[6n"); at != std::string::npos;
+         at = out.find("\033[6n", at + 1)) {
+      static const char reply[] = "\033[24;1R";
+      if (write(fd, reply, sizeof(reply) - 1) < 0)
+        return;
+    }
+  }
+}
+
+static bool send_key(int client, TermSession &term, Interactive_CLI &cli,
+                     const std::string &key) {
+  if (write(client, key.data(), key.size()) != static_cast<ssize_t>(key.size()))
+    return false;
+  if (!term.readInput())
+    return false;
+  cli.feed(term);
+  return true;
+}
+
+static bool run_case(const Case &c, bool verbose) {
+  int pair[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+    std::perror("socketpair");
+    return false;
+  }
+  const int client = pair[0], server = pair[1];
+  fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+
+  bool ok = true;
+  {
+    TermSession term(server, server);
+    Interactive_CLI cli(c.name, {c.make()});
+    cli.start(term);
+    drain(client);
+
+    // 预热：让缓冲区长到稳态容量，应答首个光标位置查询
+    for (const std::string &key : c.warmup) {
+      ok = ok && send_key(client, term, cli, key);
+      drain(client);
+    }
+
+    ProfileSample worst;
+    for (size_t i = 0; ok && i < c.keys.size(); ++i) {
+      const ProfileSample before = profile_sample();
+      ok = send_key(client, term, cli, c.keys[i]);
+      const ProfileSample cost = profile_sample() - before;
+      drain(client);
+
+      worst.allocations = std::max(worst.allocations, cost.allocations);
+      worst.writes = std::max(worst.writes, cost.writes);
+      worst.writtenBytes = std::max(worst.writtenBytes, cost.writtenBytes);
+      worst.termiosCalls = std::max(worst.termiosCalls, cost.termiosCalls);
+
+      if (cost.allocations > c.budget.allocations || cost.writes > c.budget.writes ||
+          cost.termiosCalls != 0) {
+        std::fprintf(stderr,
+                     "%s: key %zu over budget: %llu allocations (max %llu), "
+                     "%llu writes (max %llu), %llu termios calls\n",
+                     c.name, i, static_cast<unsigned long long>(cost.allocations),
+                     static_cast<unsigned long long>(c.budget.allocations),
+                     static_cast<unsigned long long>(cost.writes),
+                     static_cast<unsigned long long>(c.budget.writes),
+                     static_cast<unsigned long long>(cost.termiosCalls));
+        ok = false;
+      }
+    }
+    if (verbose)
+      std::printf("%-13s worst key: %4llu allocations, %llu writes, %5llu bytes, "
+                  "%llu termios calls\n",
+                  c.name, static_cast<unsigned long long>(worst.allocations),
+                  static_cast<unsigned long long>(worst.writes),
+                  static_cast<unsigned long long>(worst.writtenBytes),
+                  static_cast<unsigned long long>(worst.termiosCalls));
+
+    cli.hangup(term);
+  }
+  close(client);
+  close(server);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  const bool verbose = argc > 1 && std::strcmp(argv[1], "-v") == 0;
+  if (!profile_counters().allocationsCounted) {
+    std::fprintf(stderr, "allocation counting is not linked in\n");
+    return 2;
+  }
+
+  const std::vector<Case> all = cases();
+  size_t failed = 0;
+  for (const Case &c : all)
+    failed += run_case(c, verbose) ? 0 : 1;
+
+  std::printf("%zu of %zu prompts within budget\n", all.size() - failed, all.size());
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,47 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Arch/icli.h"
+
+/*
+ * Streams a simulated compiler log (about 100k lines per second) above a
+ * live prompt. The prompt stays usable while the log scrolls; lines that
+ * cannot be shown at the capped frame rate are counted instead.
+ */
+int main() {
+  auto log = std::make_shared<LogPane>();
+  std::atomic<bool> stop{false};
+  std::atomic<size_t> pushed{0};
+
+  std::thread compiler([&] {
+    using Clock = std::chrono::steady_clock;
+    auto next = Clock::now();
+    for (size_t unit = 0; !stop.load(); ++unit) {
+      log->push(ANSI_DIM("[cc]") + " compiling unit " + std::to_string(unit));
+      ++pushed;
+      // 每 100 行停 1ms，约 10 万行/秒
+      if (unit % 100 == 99) {
+        next += std::chrono::milliseconds(1);
+        std::this_thread::sleep_until(next);
+      }
+    }
+  });
+
+  Interactive_CLI cli(
+      "Building Arch",
+      {std::make_shared<CLI_PromptInput>("Build target:", "all"),
+       std::make_shared<CLI_PromptBoolean>("Run tests afterwards?")},
+      log);
+  cli.run();
+
+  stop = true;
+  compiler.join();
+  std::fprintf(stderr, "%zu log lines, %zu skipped\n", pushed.load(),
+               log->skipped());
+  return 0;
+}
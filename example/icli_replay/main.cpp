@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+/*
+ * Replays the input of an asciicast v2 recording (ARCH_ICLI_RECORD=<file>)
+ * into a program running on a fresh pty, with the original timing, then
+ * compares the output bytes and the input-to-output latency against the
+ * recording.
+ *
+ *   example_icli_replay [--tolerance-ms N] <recording.cast> <program> [args...]
+ *
+ * Exits non-zero if the output differs or the replayed p95 latency exceeds
+ * the recorded one by more than the tolerance (default 20ms).
+ *
+ * The program runs with the recording's TERM and with XDG_CACHE_HOME
+ * pointed at a private directory seeded with the terminal capabilities in
+ * effect at record time ("arch_termcaps" in the header), so neither the
+ * user's capability cache nor COLORTERM can change the output.
+ */
+
+struct Event {
+  double time;
+  char kind;
+  std::string data;
+};
+
+static void append_utf8(std::string &out, unsigned cp) {
+  if (cp < 0x80) {
+    out += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    out += static_cast<char>(0xC0 | (cp >> 6));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    out += static_cast<char>(0xE0 | (cp >> 12));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (cp >> 18));
+    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+}
+
+// 解析从 pos（指向开引号）开始的 JSON 字符串
+static bool parse_string(const std::string &line, size_t &pos, std::string &out) {
+  if (pos >= line.size() || line[pos] != '"')
+    return false;
+  for (++pos; pos < line.size(); ++pos) {
+    char ch = line[pos];
+    if (ch == '"') {
+      ++pos;
+      return true;
+    }
+    if (ch != '\\') {
+      out += ch;
+      continue;
+    }
+    if (++pos >= line.size())
+      return false;
+    switch (line[pos]) {
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'u': {
+        unsigned cp = std::strtoul(line.substr(pos + 1, 4).c_str(), nullptr, 16);
+        pos += 4;
+        // UTF-16 代理对
+        if (cp >= 0xD800 && cp < 0xDC00 && line.compare(pos + 1, 2, "\\u") == 0) {
+          unsigned low = std::strtoul(line.substr(pos + 3, 4).c_str(), nullptr, 16);
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+          pos += 6;
+        }
+        append_utf8(out, cp);
+        break;
+      }
+      default: out += line[pos]; break;
+    }
+  }
+  return false;
+}
+
+static int header_field(const std::string &header, const char *name, int fallback) {
+  size_t at = header.find(std::string("\"") + name + "\"");
+  if (at == std::string::npos)
+    return fallback;
+  at = header.find(':', at);
+  return at == std::string::npos ? fallback : std::atoi(header.c_str() + at + 1);
+}
+
+static std::string header_string(const std::string &header, const char *name) {
+  std::string value;
+  size_t at = header.find(std::string("\"") + name + "\"");
+  if (at == std::string::npos || (at = header.find(':', at)) == std::string::npos ||
+      (at = header.find('"', at)) == std::string::npos || !parse_string(header, at, value))
+    return "";
+  return value;
+}
+
+struct Recording {
+  int width, height;
+  std::string term, caps; // 录制时的 $TERM 与终端能力缓存内容
+  std::vector<Event> events;
+};
+
+static bool load_cast(const char *path, Recording &rec) {
+  std::ifstream in(path);
+  std::string line;
+  if (!std::getline(in, line))
+    return false;
+  rec.width = header_field(line, "width", 80);
+  rec.height = header_field(line, "height", 24);
+  rec.term = header_string(line, "TERM");
+  rec.caps = header_string(line, "arch_termcaps");
+  std::vector<Event> &events = rec.events;
+
+  while (std::getline(in, line)) {
+    // [time, "i"|"o", "data"]
+    size_t pos = line.find('[');
+    if (pos == std::string::npos)
+      continue;
+    char *end;
+    double time = std::strtod(line.c_str() + pos + 1, &end);
+    pos = line.find('"', end - line.c_str());
+    std::string kind, data;
+    if (!parse_string(line, pos, kind) || kind.size() != 1)
+      continue;
+    pos = line.find('"', pos);
+    if (!parse_string(line, pos, data))
+      continue;
+    events.push_back({time, kind[0], std::move(data)});
+  }
+  return true;
+}
+
+// 每个输入事件到其后第一次输出的延迟（毫秒）
+static std::vector<double> latencies(const std::vector<Event> &events) {
+  std::vector<double> result;
+  for (size_t i = 0; i < events.size(); ++i) {
+    if (events[i].kind != 'i')
+      continue;
+    for (size_t j = i + 1; j < events.size(); ++j) {
+      if (events[j].kind == 'o') {
+        result.push_back((events[j].time - events[i].time) * 1000);
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+static double percentile(std::vector<double> v, double p) {
+  if (v.empty())
+    return 0;
+  std::sort(v.begin(), v.end());
+  return v[static_cast<size_t>(p * (v.size() - 1))];
+}
+
+static std::string output_of(const std::vector<Event> &events) {
+  std::string out;
+  for (const Event &e : events)
+    if (e.kind == 'o')
+      out += e.data;
+  return out;
+}
+
+int main(int argc, char **argv) {
+  double tolerance = 20;
+  int arg = 1;
+  if (arg + 1 < argc && std::strcmp(argv[arg], "--tolerance-ms") == 0) {
+    tolerance = std::atof(argv[arg + 1]);
+    arg += 2;
+  }
+  if (argc - arg < 2) {
+    std::fprintf(stderr, "usage: %s [--tolerance-ms N] <recording.cast> <program> [args...]\n",
+                 argv[0]);
+    return 2;
+  }
+
+  Recording rec;
+  if (!load_cast(argv[arg], rec)) {
+    std::fprintf(stderr, "cannot read %s\n", argv[arg]);
+    return 2;
+  }
+  const std::vector<Event> &recorded = rec.events;
+
+  // 私有缓存目录，预置录制时的能力，子进程不再探测也不读用户缓存
+  std::string cacheDir;
+  if (!rec.caps.empty() && !rec.term.empty()) {
+    char tmpl[] = "/tmp/icli_replay.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+      std::perror("mkdtemp");
+      return 2;
+    }
+    cacheDir = tmpl;
+    std::string name = rec.term;
+    std::replace(name.begin(), name.end(), '/', '_');
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDir + "/arch/termcaps", ec);
+    std::ofstream(cacheDir + "/arch/termcaps/" + name) << rec.caps;
+  } else {
+    std::fprintf(stderr, "warning: recording has no terminal capabilities; "
+                         "output depends on the local cache\n");
+  }
+
+  struct winsize ws = {};
+  ws.ws_col = static_cast<unsigned short>(rec.width);
+  ws.ws_row = static_cast<unsigned short>(rec.height);
+  int master;
+  pid_t pid = forkpty(&master, nullptr, nullptr, &ws);
+  if (pid < 0) {
+    std::perror("forkpty");
+    return 2;
+  }
+  if (pid == 0) {
+    // 录制的是进入 tty 之前的字节：关闭输出处理（ONLCR 等）才能逐字节比较
+    struct termios tio;
+    if (tcgetattr(STDOUT_FILENO, &tio) == 0) {
+      tio.c_oflag &= ~OPOST;
+      tcsetattr(STDOUT_FILENO, TCSANOW, &tio);
+    }
+    unsetenv("ARCH_ICLI_RECORD");
+    if (!cacheDir.empty()) {
+      setenv("TERM", rec.term.c_str(), 1);
+      setenv("XDG_CACHE_HOME", cacheDir.c_str(), 1);
+      unsetenv("COLORTERM"); // 录制的能力已包含它的效果
+    }
+    execvp(argv[arg + 1], argv + arg + 1);
+    std::perror("execvp");
+    _exit(127);
+  }
+
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point begin = Clock::now();
+  auto now = [&] {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+  };
+
+  // 按原始时间写入输入，期间持续读取输出并记下时间
+  std::vector<Event> replayed;
+  bool open = true;
+  auto pump = [&](double until) {
+    while (open) {
+      double left = until - now();
+      struct pollfd pfd = {master, POLLIN, 0};
+      int rc = poll(&pfd, 1, left > 0 ? static_cast<int>(left * 1000) + 1 : 0);
+      if (rc <= 0)
+        return;
+      char buf[65536];
+      ssize_t n = read(master, buf, sizeof(buf));
+      if (n <= 0) {
+        open = false;
+        return;
+      }
+      replayed.push_back({now(), 'o', std::string(buf, n)});
+    }
+  };
+
+  double last = 0;
+  for (const Event &e : recorded) {
+    last = e.time;
+    if (e.kind != 'i')
+      continue;
+    pump(e.time);
+    if (!open)
+      break;
+    replayed.push_back({now(), 'i', e.data});
+    ssize_t n = write(master, e.data.data(), e.data.size());
+    (void)n;
+  }
+  pump(std::max(last, now()) + 1.0);
+
+  if (open)
+    kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+  close(master);
+  if (!cacheDir.empty()) {
+    std::error_code ec;
+    std::filesystem::remove_all(cacheDir, ec);
+  }
+
+  // 输出字节比较
+  const std::string expected = output_of(recorded);
+  const std::string actual = output_of(replayed);
+  size_t same = 0;
+  while (same < expected.size() && same < actual.size() && expected[same] == actual[same])
+    ++same;
+  bool outputMatches = same == expected.size() && same == actual.size();
+
+  std::vector<double> before = latencies(recorded), after = latencies(replayed);
+  std::printf("output: %zu bytes recorded, %zu replayed, %s", expected.size(),
+              actual.size(), outputMatches ? "identical\n" : "");
+  if (!outputMatches)
+    std::printf("first difference at byte %zu\n", same);
+  std::printf("latency ms   p50      p95      max\n");
+  std::printf("recorded  %7.2f  %7.2f  %7.2f\n", percentile(before, 0.5),
+              percentile(before, 0.95), percentile(before, 1));
+  std::printf("replayed  %7.2f  %7.2f  %7.2f\n", percentile(after, 0.5),
+              percentile(after, 0.95), percentile(after, 1));
+
+  bool slower = percentile(after, 0.95) > percentile(before, 0.95) + tolerance;
+  if (slower)
+    std::printf("replayed p95 exceeds recording by more than %.0fms\n", tolerance);
+  return outputMatches && !slower ? 0 : 1;
+}
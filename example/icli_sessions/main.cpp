@@ -0,0 +1,167 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "Arch/icli.h"
+#include "Arch/icli/session_executor.h"
+
+/*
+ * Stress driver for SessionExecutor: runs hundreds of concurrent sessions
+ * over socketpairs and types into all of them at once from one thread.
+ *
+ *   example_icli_sessions [sessions=500] [threads=4]
+ *
+ * Every 10th client hangs up halfway and must end as Cancelled; every 8th
+ * session validates its input asynchronously (exercising cross-thread
+ * wake-ups). Exits non-zero if any transcript or outcome is wrong.
+ */
+
+struct Client {
+  int fd = -1;
+  std::vector<std::string> script;
+  size_t step = 0;
+  bool hangup = false;
+  std::string transcript;
+  bool closed = false;
+};
+
+static std::unique_ptr<Interactive_CLI> make_cli(int index) {
+  InputValidator validator;
+  if (index % 8 == 0)
+    validator = [](const std::string &value, const ValidationToken &) {
+      return value.rfind("user-", 0) == 0 ? std::string() : "Unknown user";
+    };
+
+  auto name = std::make_shared<CLI_PromptInput>("Name:", "", validator);
+  name->validate_debounce_ms = 5;
+
+  return std::make_unique<Interactive_CLI>(
+      "Session " + std::to_string(index),
+      std::vector<std::shared_ptr<CLI_PROMPT>>{
+          name,
+          std::make_shared<CLI_PromptBoolean>("Yes or No?"),
+          std::make_shared<CLI_PromptSingleSelect>(
+              "Choose one",
+              std::vector<Option>{Option("OptionA"), Option("OptionB"),
+                                  Option("OptionC")}),
+          std::make_shared<CLI_PromptMultiSelect>(
+              "Select:",
+              std::vector<Option>{Option("Apples"), Option("Bananas"),
+                                  Option("Cherries")},
+              false)});
+}
+
+int main(int argc, char **argv) {
+  const int count = argc > 1 ? std::atoi(argv[1]) : 500;
+  const unsigned threads = argc > 2 ? std::atoi(argv[2]) : 4;
+
+  // 每个会话占用 3 个 fd（两端 socket + 唤醒 fd）
+  struct rlimit lim;
+  if (getrlimit(RLIMIT_NOFILE, &lim) == 0) {
+    lim.rlim_cur = lim.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &lim);
+  }
+
+  std::vector<Client> clients(count);
+  std::vector<PromptResult> outcomes(count, PromptResult::Pending);
+
+  auto begin = std::chrono::steady_clock::now();
+  SessionExecutor executor(threads);
+
+  for (int i = 0; i < count; ++i) {
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+      std::perror("socketpair");
+      return 2;
+    }
+    clients[i].fd = pair[0];
+    clients[i].hangup = i % 10 == 9;
+    clients[i].script = {"user-" + std::to_string(i) + "\r", "\033[C", "\r",
+                         "\033[B", "\r", " ", "\033[B", " ", "\r"};
+    fcntl(pair[0], F_SETFL, fcntl(pair[0], F_GETFL) | O_NONBLOCK);
+
+    int server = pair[1];
+    executor.add(std::make_unique<TermSession>(server, server),
+                 make_cli(i), [&, i, server](PromptResult result) {
+                   outcomes[i] = result;
+                   close(server);
+                 });
+  }
+
+  // 每轮给每个会话发一步按键，交错推进所有会话
+  std::vector<pollfd> fds(count);
+  for (int open = count; open > 0;) {
+    for (Client &c : clients) {
+      if (c.closed || c.step >= c.script.size())
+        continue;
+      if (c.hangup && c.step == 3) {
+        shutdown(c.fd, SHUT_WR);
+        c.step = c.script.size();
+      } else {
+        const std::string &keys = c.script[c.step];
+        if (write(c.fd, keys.data(), keys.size()) == static_cast<ssize_t>(keys.size()))
+          ++c.step;
+      }
+    }
+
+    for (int i = 0; i < count; ++i)
+      fds[i] = {clients[i].closed ? -1 : clients[i].fd, POLLIN, 0};
+    poll(fds.data(), fds.size(), 1);
+    for (int i = 0; i < count; ++i) {
+      Client &c = clients[i];
+      if (c.closed || !(fds[i].revents & (POLLIN | POLLHUP)))
+        continue;
+      char buf[4096];
+      ssize_t n;
+      while ((n = read(c.fd, buf, sizeof(buf))) > 0)
+        c.transcript.append(buf, n);
+      if (n == 0) {
+        close(c.fd);
+        c.closed = true;
+        --open;
+      }
+    }
+  }
+  executor.wait();
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - begin);
+
+  int accepted = 0, cancelled = 0, wrong = 0;
+  for (int i = 0; i < count; ++i) {
+    const std::string &t = clients[i].transcript;
+    bool ok;
+    if (clients[i].hangup) {
+      ok = outcomes[i] == PromptResult::Cancelled &&
+           t.find("Operation cancelled") != std::string::npos;
+      cancelled += ok;
+    } else {
+      ok = outcomes[i] == PromptResult::Accepted &&
+           t.find("user-" + std::to_string(i) + "\033") != std::string::npos &&
+           t.find("OptionB") != std::string::npos &&
+           t.find(", Bananas") != std::string::npos;
+      accepted += ok;
+    }
+    if (!ok) {
+      ++wrong;
+      if (wrong <= 3)
+        std::fprintf(stderr, "session %d: unexpected transcript\n%s\n", i,
+                     t.c_str());
+    }
+  }
+
+  std::printf("%d sessions on %u threads in %lld ms: %d accepted, %d "
+              "cancelled, %d wrong\n",
+              count, threads, static_cast<long long>(elapsed.count()),
+              accepted, cancelled, wrong);
+  return wrong == 0 ? 0 : 1;
+}
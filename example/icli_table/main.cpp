@@ -0,0 +1,58 @@
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Arch/icli.h"
+
+/*
+ * Picks a package out of one million generated rows. Rows are computed on
+ * demand from their index, so nothing but the sort index is ever stored.
+ */
+static uint64_t mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+static uint64_t package_size(size_t row) { return mix(row) % 500000 + 1; }
+
+static std::string package_cell(size_t row, size_t column) {
+  static const char *words[] = {"fast", "tiny", "json", "async", "crypto",
+                                "image", "http", "math", "parser", "logging"};
+  uint64_t h = mix(row * 7 + 1);
+  switch (column) {
+    case 0: return std::string(words[h % 10]) + "-" + words[(h >> 8) % 10] +
+                   "-" + std::to_string(row);
+    case 1: return std::to_string(h % 5) + "." + std::to_string((h >> 4) % 20) +
+                   "." + std::to_string((h >> 12) % 10);
+    case 2: return std::to_string(package_size(row));
+    default: return std::string("A ") + words[(h >> 16) % 10] +
+                    " library for " + words[(h >> 24) % 10] + " workloads";
+  }
+}
+
+int main() {
+  const size_t rows = 1000000;
+
+  std::vector<TableColumn> columns = {TableColumn("Package"),
+                                      TableColumn("Version"),
+                                      TableColumn("Size (KB)", 0, true),
+                                      TableColumn("Description")};
+  // 数值列直接比较原始数据，排序时不生成字符串
+  columns[2].less = [](size_t a, size_t b) {
+    return package_size(a) < package_size(b);
+  };
+
+  auto table = std::make_shared<CLI_PromptTable>("Pick a package", columns,
+                                                 rows, package_cell);
+
+  Interactive_CLI cli("Package index", {table});
+  cli.run();
+
+  std::printf("row %zu: %s\n", table->selectedRow(),
+              package_cell(table->selectedRow(), 0).c_str());
+  return 0;
+}
@@ -0,0 +1,103 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "Arch/icli/term_session.h"
+
+/*
+ * Regression driver for cross-thread wake-ups of a TermSession.
+ *
+ *   example_icli_wake [wakes=1000000]
+ *
+ * First a wake() is injected exactly while consumeWake() drains the wake
+ * fd (this program interposes read()); the next wake() must still make
+ * wait() return. Then one thread posts work and calls wake() in a tight
+ * loop while the session thread consumes the wake-ups. A swallowed
+ * wake-up leaves work that wait() never reports; the driver then exits
+ * non-zero.
+ */
+
+// 读唤醒 fd 之前注入一次 wake()，模拟另一线程恰好在此刻唤醒
+static std::atomic<int> injectFd{-1};
+static std::atomic<TermSession *> injectInto{nullptr};
+
+extern "C" ssize_t read(int fd, void *buf, size_t len) {
+  if (fd == injectFd.load())
+    if (TermSession *term = injectInto.exchange(nullptr))
+      term->wake();
+  return syscall(SYS_read, fd, buf, len);
+}
+
+static bool drain_interleaving(TermSession &term) {
+  term.wake();
+  if (!(term.wait(1000) & TermSession::Woken))
+    return false;
+  injectFd = term.wakeFd();
+  injectInto = &term;
+  term.consumeWake();
+  injectFd = -1;
+
+  // 注入的唤醒已在本轮消费；之后的唤醒必须让 wake fd 重新可读
+  term.wake();
+  if (!(term.wait(1000) & TermSession::Woken))
+    return false;
+  return term.consumeWake();
+}
+
+static bool tight_loop(TermSession &term, unsigned long total) {
+  std::atomic<unsigned long> posted{0};
+  std::thread producer([&] {
+    for (unsigned long i = 0; i < total; ++i) {
+      posted.fetch_add(1);
+      term.wake();
+    }
+  });
+
+  // 每次唤醒后取走全部已发布的工作；超时说明有唤醒丢失
+  bool ok = true;
+  unsigned long seen = 0, rounds = 0;
+  while (seen < total) {
+    unsigned ready = term.wait(1000);
+    if (ready == 0) {
+      std::fprintf(stderr, "lost wake-up: %lu of %lu posts seen\n", seen, total);
+      ok = false;
+      break;
+    }
+    if ((ready & TermSession::Woken) && term.consumeWake()) {
+      seen = posted.load();
+      ++rounds;
+    }
+  }
+  // wake() 不阻塞，丢失后生产者同样会结束
+  producer.join();
+  if (ok)
+    std::printf("%lu wake-ups delivered in %lu rounds\n", total, rounds);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  const unsigned long total = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+  int pair[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+    std::perror("socketpair");
+    return 2;
+  }
+
+  bool ok;
+  {
+    TermSession term(pair[1], pair[1]);
+    ok = drain_interleaving(term);
+    if (!ok)
+      std::fprintf(stderr, "wake-up during consumeWake() was lost\n");
+    ok = ok && tight_loop(term, total);
+  }
+  close(pair[0]);
+  close(pair[1]);
+  return ok ? 0 : 1;
+}
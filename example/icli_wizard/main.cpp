@@ -0,0 +1,82 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Arch/icli.h"
+
+/*
+ * Setup wizard built as a PromptGraph. Prompts are created only when the
+ * flow reaches them, so of the sixty-odd nodes below a typical run builds
+ * five or six. Shift-Tab steps back to the previous question.
+ *
+ * Answers are remembered between runs (AnswerStore): the next run offers
+ * the previous values as defaults and lists recently used targets first.
+ */
+int main() {
+  auto flow = std::make_shared<PromptGraph>();
+  int built = 0;
+
+  auto input = [&built](std::string label, std::string fallback = "") {
+    return [&built, label, fallback](const Answers &) {
+      ++built;
+      return std::make_shared<CLI_PromptInput>(label, fallback);
+    };
+  };
+  auto yes_no = [&built](std::string label) {
+    return [&built, label](const Answers &) {
+      ++built;
+      return std::make_shared<CLI_PromptBoolean>(label);
+    };
+  };
+
+  const std::vector<std::string> targets = {"Native", "WebAssembly", "Embedded"};
+  flow->node("name", input("Project name:", "arch-app"))
+      .node("target", [&](const Answers &answers) {
+        ++built;
+        std::vector<Option> options;
+        for (const std::string &t : targets)
+          options.emplace_back(t);
+        // 工厂可以读取之前的回答
+        return std::make_shared<CLI_PromptSingleSelect>(
+            "Target for " + *answers.get<std::string>("name") + ":", options);
+      })
+      .edge("name", "target");
+
+  // 每个目标各有一串专属问题，只有选中的那一支会被构造
+  for (const std::string &t : targets) {
+    std::string prev = "target";
+    for (int i = 1; i <= 20; ++i) {
+      std::string id = t + "." + std::to_string(i);
+      if (i % 7 == 0)
+        flow->node(id, yes_no(t + " option " + std::to_string(i) + "?"));
+      else
+        flow->node(id, input(t + " setting " + std::to_string(i) + ":", "default"));
+      if (prev == "target")
+        flow->edge(prev, id, [t](const Answers &a) { return a.equals("target", t); });
+      else
+        flow->edge(prev, id);
+      prev = id;
+      // 问到第三个设置后可以跳到最后
+      if (i == 3) {
+        flow->node(t + ".more", yes_no("Configure advanced " + t + " settings?"));
+        flow->edge(id, t + ".more");
+        flow->edge(t + ".more", "done",
+                   [t](const Answers &a) { return a.equals(t + ".more", false); });
+        prev = t + ".more";
+      }
+    }
+    flow->edge(prev, "done");
+  }
+  flow->node("done", [&](const Answers &) {
+    ++built;
+    return std::make_shared<CLI_PromptContinue>("Write configuration?");
+  });
+
+  Interactive_CLI cli("Arch project setup", flow);
+  if (std::string path = AnswerStore::defaultPath("example_icli_wizard"); !path.empty())
+    cli.store = std::make_shared<AnswerStore>(path);
+  cli.run();
+  std::printf("%d of %zu prompts constructed\n", built, flow->size());
+  return 0;
+}
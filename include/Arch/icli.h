@@ -1,10 +1,23 @@
 #pragma once
 
+#include "Arch/icli/answer_store.h"
+#include "Arch/icli/async_validator.h"
+#include "Arch/icli/bit_set.h"
+#include "Arch/icli/hit_map.h"
+#include "Arch/icli/log_pane.h"
+#include "Arch/icli/prompt_graph.h"
+#include "Arch/icli/term_frame.h"
+#include "Arch/icli/term_session.h"
 #include "Arch/icli/terminal_utils.h"
+#include "Arch/icli/wrap_cache.h"
+#include <functional>
+#include <limits>
 #include <memory>
 #include <vector>
 
 enum PromptState { Activated, Succeed, Failed, Invisible };
+// Pending：仍在等待输入；Declined：用户选择退出；Cancelled：Esc/Ctrl-C 或会话断开
+enum class PromptResult { Pending, Accepted, Declined, Cancelled };
 enum BooleanChoice { Yes, No };
 struct Option {
   std::string option, description;
@@ -12,11 +25,47 @@ struct Option {
       : option(option), description(description) {}
 };
 
-/* Abstract Prompt */
+/*
+ * Abstract Prompt
+ *
+ * Prompts are driven by events so that many sessions can share a few
+ * threads: the runner feeds decoded keys to handle(), calls tick() when the
+ * session is woken from another thread, and repaints with prompt().
+ * Frames are relative to the prompt's region (row 0 is the header).
+ * A prompt may be reopened after it was accepted (the user stepped back),
+ * so begin() must not assume a fresh object.
+ */
 struct CLI_PROMPT {
   PromptState state = PromptState::Activated;
-  virtual void prompt(TermCoord pos) const = 0;
-  virtual bool run(bool isLastPrompt) = 0;
+
+  // 提示区域的行数（含首行和底线）
+  virtual int rows() const = 0;
+  virtual void begin(TermSession & /*term*/) {}
+  // 重绘整个区域，每行以 \033[K 结尾
+  virtual void prompt(TermFrame &out) const = 0;
+  virtual PromptResult handle(TermSession &term, const KeyEvent &evt) = 0;
+  virtual PromptResult tick(TermSession & /*term*/) { return PromptResult::Pending; }
+  // 为 true 时暂停分发按键，预输入留在会话中（如 Enter 正在等待校验结果）
+  virtual bool busy() const { return false; }
+  // 为 true 时在提示期间开启鼠标上报，鼠标事件交给 handleMouse()
+  virtual bool wantsMouse() const { return false; }
+  // evt 的 y 为区域行；只有 changed 置为 true 时才重绘
+  virtual PromptResult handleMouse(TermSession & /*term*/, const KeyEvent & /*evt*/,
+                                   bool & /*changed*/) {
+    return PromptResult::Pending;
+  }
+  // 从区域首行开始写出问答记录，并释放 begin() 中申请的资源
+  virtual void finish(TermFrame &out, PromptResult result) = 0;
+  // 用户返回上一步、本提示不再显示时调用：只释放资源，不写问答记录
+  virtual void abandon(TermFrame & /*out*/) {}
+  // 被接受后的回答，供 PromptGraph 的条件使用
+  virtual Answer answer() const { return std::monostate(); }
+  // 线性流程中作为 AnswerStore 的键；为空时不记忆
+  virtual std::string name() const { return ""; }
+  // 用记忆的回答预填/预选；构造后、首次 begin() 前调用一次
+  virtual void recall(const AnswerStore & /*store*/, const std::string & /*key*/) {}
+  // 整个流程被接受后记录本提示的回答
+  virtual void remember(AnswerStore & /*store*/, const std::string & /*key*/) const {}
   virtual ~CLI_PROMPT() = default;
 };
 
@@ -25,9 +74,24 @@ struct CLI_PromptContinue final : CLI_PROMPT {
   std::string label;
   BooleanChoice choice = Yes;
 
+  bool mouse = true; // 点击 Yes/No 选择并确认
+
   explicit CLI_PromptContinue(std::string text) : label(std::move(text)) {}
-  void prompt(TermCoord pos) const override;
-  bool run(bool isLastPrompt) override;
+  int rows() const override { return 3; }
+  void prompt(TermFrame &out) const override;
+  PromptResult handle(TermSession &term, const KeyEvent &evt) override;
+  bool wantsMouse() const override { return mouse; }
+  PromptResult handleMouse(TermSession &term, const KeyEvent &evt,
+                           bool &changed) override;
+  void finish(TermFrame &out, PromptResult result) override;
+  Answer answer() const override { return choice == Yes; }
+  std::string name() const override { return label; }
+  void recall(const AnswerStore &store, const std::string &key) override;
+  void remember(AnswerStore &store, const std::string &key) const override;
+
+private:
+  mutable HitMap hits;
+  int pressed = HitMap::none;
 };
 
 
@@ -37,11 +101,32 @@ struct CLI_PromptInput final : CLI_PROMPT {
   std::string fallback;
   bool warn_need_input = false;
 
-  explicit CLI_PromptInput(std::string text, std::string fallback="") : label(std::move(text)), fallback(fallback){}
+  // 可选的异步校验；结果显示在底栏，Enter 只等待最新一次的结果
+  InputValidator validator;
+  int validate_debounce_ms = 150;
+  std::string validation_message;
+  std::unique_ptr<AsyncValidator> checker;
+  bool enter_pending = false; // 已按 Enter，等待校验结果
+  bool bracketed_paste = false;
+  bool pasting = false;
 
-  void prompt(TermCoord pos) const override;
+  explicit CLI_PromptInput(std::string text, std::string fallback="",
+                           InputValidator validator = nullptr)
+      : label(std::move(text)), fallback(fallback),
+        validator(std::move(validator)) {}
 
-  bool run(bool isLastPrompt) override;
+  int rows() const override { return 3; }
+  void begin(TermSession &term) override;
+  void prompt(TermFrame &out) const override;
+  PromptResult handle(TermSession &term, const KeyEvent &evt) override;
+  PromptResult tick(TermSession &term) override;
+  bool busy() const override { return enter_pending; }
+  void finish(TermFrame &out, PromptResult result) override;
+  void abandon(TermFrame &out) override;
+  Answer answer() const override { return input; }
+  std::string name() const override { return label; }
+  void recall(const AnswerStore &store, const std::string &key) override;
+  void remember(AnswerStore &store, const std::string &key) const override;
 };
 
 /* Yes/No Continue Prompt */
@@ -49,54 +134,268 @@ struct CLI_PromptBoolean : CLI_PROMPT {
   std::string label;
   BooleanChoice choice = Yes;
 
+  bool mouse = true; // 点击 Yes/No 选择并确认
+
   explicit CLI_PromptBoolean(std::string text) : label(std::move(text)) {}
 
-  void prompt(TermCoord pos) const override;
+  int rows() const override { return 3; }
+  void prompt(TermFrame &out) const override;
+  PromptResult handle(TermSession &term, const KeyEvent &evt) override;
+  bool wantsMouse() const override { return mouse; }
+  PromptResult handleMouse(TermSession &term, const KeyEvent &evt,
+                           bool &changed) override;
+  void finish(TermFrame &out, PromptResult result) override;
+  Answer answer() const override { return choice == Yes; }
+  std::string name() const override { return label; }
+  void recall(const AnswerStore &store, const std::string &key) override;
+  void remember(AnswerStore &store, const std::string &key) const override;
 
-  bool run(bool isLastPrompt) override;
+private:
+  mutable HitMap hits;
+  int pressed = HitMap::none;
 };
 
 struct CLI_PromptSingleSelect final : CLI_PROMPT {
   std::string label;
   std::vector<Option> options;
   int selectedIndex = 0;
+  int pageRows = 10; // 超出时只显示一页，随选中项或滚轮滚动
+  int top = 0;       // 首个可见项
+  bool mouse = true; // 点击选择，滚轮滚动
+  bool rank = true;  // 有 AnswerStore 时按最近/常用程度重排选项
+  int descriptionRows = 3; // 高亮项描述面板的行数；所有选项都没有描述时不显示
 
   CLI_PromptSingleSelect(std::string label, std::vector<Option> opts)
       : label(std::move(label)), options(std::move(opts)) {}
 
-  void prompt(TermCoord pos) const override;
+  int rows() const override { return visibleRows() + panelRows() + 2; }
+  void begin(TermSession &term) override;
+  void prompt(TermFrame &out) const override;
+  PromptResult handle(TermSession &term, const KeyEvent &evt) override;
+  bool wantsMouse() const override { return mouse; }
+  PromptResult handleMouse(TermSession &term, const KeyEvent &evt,
+                           bool &changed) override;
+  void finish(TermFrame &out, PromptResult result) override;
+  Answer answer() const override;
+  std::string name() const override { return label; }
+  void recall(const AnswerStore &store, const std::string &key) override;
+  void remember(AnswerStore &store, const std::string &key) const override;
+
+private:
+  int visibleRows() const;
+  int panelRows() const { return described ? std::max(descriptionRows, 0) : 0; }
+  void scrollTo(int index);
 
-  bool run(bool isLastPrompt) override;
+  mutable HitMap hits;
+  int pressed = HitMap::none;
+  bool described = false;
+  mutable WrapCache wrapped; // 描述的折行结果，按选项缓存
 };
 
+/*
+ * Checkbox list.
+ *
+ * Space toggles the highlighted option; Shift with the arrows, PgUp/PgDn,
+ * Home/End or a click extends from the last toggled option, giving the
+ * range that option's state. 'a' selects all, 'n' clears, 'i' inverts,
+ * and '/' types a filter whose matches Enter adds to the selection.
+ * Selection is a BitSet, so bulk operations cost a pass over packed words
+ * and a repaint still only draws the visible page.
+ */
 struct CLI_PromptMultiSelect : CLI_PROMPT {
   bool nullable = true;
   std::string label;
   std::vector<Option> options;
-  std::vector<bool> selected;
+  BitSet selected;
   int selectedIndex = 0;
-  int selectedCount = 0;
   bool warn_no_selection = false;
+  int pageRows = 10; // 超出时只显示一页，随选中项或滚轮滚动
+  int top = 0;       // 首个可见项
+  bool mouse = true; // 点击切换选中，滚轮滚动
+  bool rank = true;  // 有 AnswerStore 时按最近/常用程度重排选项
+  int descriptionRows = 3; // 高亮项描述面板的行数；所有选项都没有描述时不显示
 
   CLI_PromptMultiSelect(std::string label, std::vector<Option> opts,
                         bool nullable = true)
       : nullable(nullable), label(std::move(label)), options(std::move(opts)) {
-    selected.resize(options.size(), false);
+    selected.resize(options.size());
   }
 
-  void prompt(TermCoord pos) const override;
+  int rows() const override { return visibleRows() + panelRows() + 2; }
+  void begin(TermSession &term) override;
+  void prompt(TermFrame &out) const override;
+  PromptResult handle(TermSession &term, const KeyEvent &evt) override;
+  bool wantsMouse() const override { return mouse; }
+  PromptResult handleMouse(TermSession &term, const KeyEvent &evt,
+                           bool &changed) override;
+  void finish(TermFrame &out, PromptResult result) override;
+  Answer answer() const override;
+  std::string name() const override { return label; }
+  void recall(const AnswerStore &store, const std::string &key) override;
+  void remember(AnswerStore &store, const std::string &key) const override;
+
+  size_t selectedCount() const { return selected.count(); }
 
-  bool run(bool isLastPrompt) override;
+private:
+  int visibleRows() const;
+  int panelRows() const { return described ? std::max(descriptionRows, 0) : 0; }
+  void scrollTo(int index);
+  // 移动到 index；shift 时把 anchor 到 index 的范围设为 anchor 的状态
+  void moveTo(int index, bool shift);
+  void toggle(int index);
+  PromptResult handleFilter(const KeyEvent &evt);
+  // narrowed：过滤词只是变长了，只需复查已匹配的项
+  void updateFilter(bool narrowed);
+
+  mutable HitMap hits;
+  int pressed = HitMap::none;
+  bool described = false;
+  mutable WrapCache wrapped; // 描述的折行结果，按选项缓存
+  int anchor = 0;          // 最近一次切换的项
+  bool filtering = false;
+  std::string filter;      // 小写
+  BitSet matches;          // 与 filter 匹配的项
+};
+
+/* Table column; width 0 means auto-sized from a sample of the rows */
+struct TableColumn {
+  std::string title;
+  int width = 0;
+  bool numeric = false; // 右对齐，按数值排序
+  // 可选：按行号比较，排序时不必逐行取出字符串
+  std::function<bool(size_t, size_t)> less;
+
+  explicit TableColumn(std::string title, int width = 0, bool numeric = false)
+      : title(std::move(title)), width(width), numeric(numeric) {}
 };
 
-/* Interactive CLI Runner */
+// 按需读取单元格：表格不保存行数据
+using TableCellFn = std::function<std::string(size_t row, size_t column)>;
+
+/*
+ * Table prompt for picking one row out of a large dataset.
+ *
+ * Only the visible rows and the columns that fit are ever read, so opening
+ * and scrolling cost the same for 10 rows or 10M. Sorting permutes an
+ * index vector; rows are never copied.
+ */
+struct CLI_PromptTable final : CLI_PROMPT {
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  std::string label;
+  std::vector<TableColumn> columns;
+  size_t rowCount;
+  TableCellFn cell;
+  int pageRows = 10;
+  size_t widthSample = 1000; // 自动列宽抽样的行数
+  int maxColumnWidth = 40;
+
+  size_t selectedIndex = 0; // 显示位置
+  size_t top = 0;           // 首个可见的显示位置
+  size_t firstColumn = 0;   // 首个可见列
+  int sortColumn = -1;
+  bool sortDescending = false;
+
+  CLI_PromptTable(std::string label, std::vector<TableColumn> cols,
+                  size_t rowCount, TableCellFn cell)
+      : label(std::move(label)), columns(std::move(cols)), rowCount(rowCount),
+        cell(std::move(cell)) {}
+
+  // 选中行的行号；空表为 npos
+  size_t selectedRow() const { return rowCount ? rowAt(selectedIndex) : npos; }
+
+  // 按列排序，保持当前选中行不变
+  void sortBy(int column, bool descending);
+
+  int rows() const override { return visibleRows() + 3; }
+  void begin(TermSession &term) override;
+  void prompt(TermFrame &out) const override;
+  PromptResult handle(TermSession &term, const KeyEvent &evt) override;
+  void finish(TermFrame &out, PromptResult result) override;
+  Answer answer() const override { return selectedRow(); }
+
+private:
+  int visibleRows() const;
+  size_t rowAt(size_t pos) const { return order.empty() ? pos : order[pos]; }
+  // 让选中行可见，并用可见行扩展自动列宽
+  void scrollTo(size_t pos);
+  // 只测量当前放得下的列；begin() 之前不做任何事
+  void measureVisible() const;
+  void measure(size_t row, size_t column) const;
+  std::string renderRow(size_t row, bool header) const;
+
+  std::vector<size_t> order; // 显示位置 -> 行号；未排序时为空
+  // 列宽随可见行只增不减，终端宽度变化时在 prompt() 中补测
+  mutable std::vector<int> widths;
+  mutable std::vector<bool> sampled; // 列是否已抽样估计过宽度
+  mutable int viewWidth = 80;
+};
+
+/*
+ * Interactive CLI Runner
+ *
+ * run() drives one session on the process's own terminal. Other hosts
+ * (e.g. SessionExecutor) call start() once and then feed()/tick()/hangup()
+ * as events arrive, until outcome is no longer Pending.
+ *
+ * The flow is either a fixed list of prompts or a PromptGraph. Shift-Tab
+ * steps back to the previous prompt: only that prompt's transcript is
+ * erased and the prompt reopens with its earlier input.
+ *
+ * If log is set, lines pushed to it from any thread are printed above the
+ * active prompt while the session runs. If store is set, prompts are
+ * prefilled from it when reached and their answers are saved to it when
+ * the whole flow is accepted.
+ */
 struct Interactive_CLI {
   std::string greeting;
-  std::vector<std::shared_ptr<CLI_PROMPT>> prompts;
+  std::vector<std::shared_ptr<CLI_PROMPT>> prompts; // 线性流程；设置了 graph 时不使用
+  std::shared_ptr<PromptGraph> graph;
+  std::shared_ptr<LogPane> log;
+  std::shared_ptr<AnswerStore> store;
+  Answers answers; // 已接受提示的回答，线性流程以序号为 id
+  PromptResult outcome = PromptResult::Pending;
 
   Interactive_CLI(std::string greet,
-                  std::vector<std::shared_ptr<CLI_PROMPT>> list)
-      : greeting(std::move(greet)), prompts(std::move(list)) {}
+                  std::vector<std::shared_ptr<CLI_PROMPT>> list,
+                  std::shared_ptr<LogPane> log = nullptr)
+      : greeting(std::move(greet)), prompts(std::move(list)), log(std::move(log)) {}
+  Interactive_CLI(std::string greet, std::shared_ptr<PromptGraph> flow,
+                  std::shared_ptr<LogPane> log = nullptr)
+      : greeting(std::move(greet)), graph(std::move(flow)), log(std::move(log)) {}
+  ~Interactive_CLI();
+
+  void start(TermSession &term);
+  // 处理会话中已读入的全部按键
+  void feed(TermSession &term);
+  // 会话被 wake() 唤醒后调用
+  void tick(TermSession &term);
+  // 输入端关闭：按取消结束
+  void hangup(TermSession &term);
 
+  // 在 stdin/stdout 上运行；拒绝时 exit(0)，取消时 exit(1)
   void run();
+
+private:
+  // 走过的一个节点；prompt 保留下来，返回上一步时原样重新打开
+  struct Step {
+    size_t node;
+    std::shared_ptr<CLI_PROMPT> prompt;
+    int transcript = 0; // 问答记录首行在会话中的位置（TermSession::transcriptRows）
+  };
+
+  CLI_PROMPT &active() { return *path.back().prompt; }
+  // AnswerStore 的键：图流程用节点 id，线性流程用提示的 name()
+  std::string storeKey(const Step &step) const;
+  // 从 node 起跳过工厂返回 nullptr 的节点，返回要打开的节点（流程结束为 npos）
+  size_t resolve(size_t node, std::shared_ptr<CLI_PROMPT> &prompt) const;
+  void open(TermSession &term, size_t node, std::shared_ptr<CLI_PROMPT> prompt);
+  void back(TermSession &term);
+  void settle(TermSession &term, PromptResult result);
+  void present(TermSession &term);
+  void flushLog(TermSession &term);
+
+  std::vector<Step> path;
+  bool linear = false;
+  bool logAttached = false;
 };
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Small persistent key-value store for prompt answers.
+ *
+ * The file is a fixed-size open-addressing hash table that is mapped into
+ * memory: opening it is one mmap, and every lookup hashes the key and
+ * probes at most a few fixed-size slots, so using the store costs the
+ * same whether it holds ten answers or a thousand. When a probe window is
+ * full the least recently used slot in it is replaced.
+ *
+ * Two kinds of entries are kept, both keyed by the prompt's key (its
+ * PromptGraph node id, or its label in a plain prompt list):
+ *   - the last text answer (input value, Yes/No);
+ *   - per-option usage (how often and how recently it was chosen, and
+ *     whether it was chosen last time), used to rank and preselect.
+ *
+ * The recency clock advances once per answer (beginAnswer()), not per
+ * write, so the score's half-life counts answers whatever their size. One
+ * answer records at most maxUsagePerAnswer chosen options, so a
+ * multi-select with hundreds of options cannot evict every other
+ * prompt's entries.
+ *
+ * Writes go straight to the shared mapping; concurrent writers are not
+ * coordinated, and a lost update only loses one remembered answer. Slots
+ * whose lengths do not fit (a damaged file) are treated as empty.
+ */
+class AnswerStore {
+public:
+  struct Usage {
+    uint32_t count = 0; // 被选中的次数
+    uint64_t last = 0;  // 最后一次选中时的逻辑时钟，0 为从未选中
+    bool chosen = false; // 上一次回答时是否选中
+  };
+
+  // 文件不存在时创建；无法打开或格式不符时 ok() 为 false，所有调用为空操作
+  explicit AnswerStore(const std::string &path, size_t slots = 1024);
+  ~AnswerStore();
+
+  AnswerStore(const AnswerStore &) = delete;
+  AnswerStore &operator=(const AnswerStore &) = delete;
+
+  // 每次回答最多记录的选中项；调用方应先传入最常用的选项
+  static constexpr size_t maxUsagePerAnswer = 32;
+
+  bool ok() const { return header != nullptr; }
+
+  // 开始记录一次回答：推进逻辑时钟，之后的写入都带这个时刻
+  void beginAnswer();
+
+  // 最近一次的文本回答；没有记录时返回 false
+  bool text(const std::string &key, std::string &value) const;
+  void setText(const std::string &key, const std::string &value);
+
+  Usage usage(const std::string &key, const std::string &option) const;
+  // 记录一次回答：chosen 的选项计数加一；未选中的只清除“上次选中”标记
+  void choose(const std::string &key, const std::string &option, bool chosen);
+
+  // 使用频率随时间衰减的排序分数，从未选中为 0
+  double score(const Usage &usage) const;
+
+  // $XDG_STATE_HOME/arch/answers/<name>（默认 ~/.local/state）；无法确定时为空
+  static std::string defaultPath(const std::string &name);
+
+private:
+  struct Header;
+  struct Slot;
+
+  Slot *lookup(uint8_t kind, const std::string &key) const;
+  Slot *insert(uint8_t kind, const std::string &key);
+  uint64_t now();
+
+  Header *header = nullptr;
+  size_t usageWrites = 0; // 本次回答已记录的选中项
+  Slot *slots = nullptr;
+  size_t mask = 0;
+  size_t mapped = 0;
+};
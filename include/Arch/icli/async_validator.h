@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/* Handed to validators so long checks can bail out once the input moved on */
+struct ValidationToken {
+  uint64_t generation;
+  const std::atomic<uint64_t> *latest;
+
+  bool cancelled() const {
+    return latest->load(std::memory_order_relaxed) != generation;
+  }
+};
+
+// 返回空串表示通过，否则为显示在底栏的警告信息
+using InputValidator =
+    std::function<std::string(const std::string &value,
+                              const ValidationToken &token)>;
+
+/* Debounced validator running on its own worker thread */
+class AsyncValidator {
+public:
+  // notify 在工作线程上调用，表示最新结果已就绪
+  AsyncValidator(InputValidator fn, std::chrono::milliseconds debounce,
+                 std::function<void()> notify = nullptr);
+  ~AsyncValidator();
+
+  AsyncValidator(const AsyncValidator &) = delete;
+  AsyncValidator &operator=(const AsyncValidator &) = delete;
+
+  // Starts a new generation; earlier ones are dropped or cancelled
+  void submit(std::string value);
+
+  // True once the latest generation has a result
+  bool ready() const;
+
+  // Result of the newest finished generation (may be stale if !ready())
+  std::string message() const;
+
+  // Skips the debounce delay for the pending generation
+  void flush();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  void worker();
+
+  InputValidator fn;
+  std::chrono::milliseconds debounce;
+  std::function<void()> notify;
+
+  mutable std::mutex mu;
+  std::condition_variable cv;
+
+  std::atomic<uint64_t> latest{0};
+  uint64_t resultGeneration = 0;
+  std::string pendingValue;
+  std::string result;
+  Clock::time_point deadline;
+  bool pending = false;
+  bool skipDebounce = false;
+  bool stop = false;
+
+  std::thread thread;
+};
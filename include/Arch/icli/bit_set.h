@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/*
+ * Fixed-size set of bits packed into 64-bit words.
+ *
+ * Bulk operations (fill, invert, ranges, union) touch whole words, and the
+ * number of set bits is kept up to date as bits change, so count() is free
+ * and even a full pass over 100k bits is a few thousand word operations.
+ * Bits past size() in the last word are always zero.
+ */
+class BitSet {
+public:
+  BitSet() = default;
+  explicit BitSet(size_t size, bool value = false) { resize(size, value); }
+
+  size_t size() const { return bits; }
+  size_t count() const { return ones; }
+  bool any() const { return ones != 0; }
+  bool all() const { return ones == bits; }
+
+  bool test(size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+  bool operator[](size_t i) const { return test(i); }
+
+  void set(size_t i, bool value = true) {
+    if (test(i) != value)
+      flip(i);
+  }
+
+  void flip(size_t i) {
+    uint64_t &word = words[i / 64];
+    const uint64_t bit = uint64_t(1) << (i % 64);
+    if (word & bit)
+      --ones;
+    else
+      ++ones;
+    word ^= bit;
+  }
+
+  // 保留已有的位，新增的位为 value
+  void resize(size_t size, bool value = false) {
+    const size_t old = bits;
+    words.resize((size + 63) / 64, 0);
+    bits = size;
+    if (size > old && value)
+      assign(old, size, true);
+    trim();
+    recount();
+  }
+
+  void fill(bool value) { assign(0, bits, value); }
+
+  void invert() {
+    for (uint64_t &word : words)
+      word = ~word;
+    trim();
+    ones = bits - ones;
+  }
+
+  // 把 [first, last) 置为 value
+  void assign(size_t first, size_t last, bool value) {
+    if (first >= last)
+      return;
+    size_t lo = first / 64, hi = (last - 1) / 64;
+    for (size_t w = lo; w <= hi; ++w) {
+      uint64_t mask = ~uint64_t(0);
+      if (w == lo)
+        mask &= ~uint64_t(0) << (first % 64);
+      if (w == hi && last % 64)
+        mask &= ~uint64_t(0) >> (64 - last % 64);
+      const uint64_t old = words[w];
+      words[w] = value ? (old | mask) : (old & ~mask);
+      ones += popcount(words[w]) - popcount(old);
+    }
+  }
+
+  // 并入 other（大小须相同）
+  BitSet &operator|=(const BitSet &other) {
+    ones = 0;
+    for (size_t w = 0; w < words.size(); ++w) {
+      words[w] |= other.words[w];
+      ones += popcount(words[w]);
+    }
+    return *this;
+  }
+
+  // 依次对每个为 1 的位调用 f(i)，跳过全零的字
+  template <class F> void forEach(F f) const {
+    for (size_t w = 0; w < words.size(); ++w)
+      for (uint64_t word = words[w]; word; word &= word - 1)
+        f(w * 64 + lowest(word));
+  }
+
+  // 不小于 from 的第一个为 1 的位；没有时为 size()
+  size_t next(size_t from) const {
+    if (from >= bits)
+      return bits;
+    size_t w = from / 64;
+    uint64_t word = words[w] & (~uint64_t(0) << (from % 64));
+    while (!word) {
+      if (++w == words.size())
+        return bits;
+      word = words[w];
+    }
+    return w * 64 + lowest(word);
+  }
+
+  static size_t popcount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<size_t>(__builtin_popcountll(word));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return static_cast<size_t>(__popcnt64(word));
+#else
+    size_t n = 0;
+    for (; word; word &= word - 1)
+      ++n;
+    return n;
+#endif
+  }
+
+private:
+  // 最低的 1 位的序号，word 不为 0
+  static size_t lowest(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<size_t>(__builtin_ctzll(word));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return index;
+#else
+    return popcount((word & (~word + 1)) - 1);
+#endif
+  }
+
+  // 清除末字中超出 size() 的位
+  void trim() {
+    if (bits % 64)
+      words.back() &= ~uint64_t(0) >> (64 - bits % 64);
+  }
+
+  void recount() {
+    ones = 0;
+    for (uint64_t word : words)
+      ones += popcount(word);
+  }
+
+  std::vector<uint64_t> words;
+  size_t bits = 0;
+  size_t ones = 0;
+};
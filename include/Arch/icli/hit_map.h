@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+/*
+ * Row -> item map for mouse hit testing, filled in by a prompt's renderer.
+ *
+ * Rows are relative to the prompt region. Each row holds the few column
+ * spans drawn on it, so a lookup is an index plus a scan of at most a
+ * handful of spans, never a search over the prompt's options.
+ */
+class HitMap {
+public:
+  static constexpr int none = -1;
+
+  // 清空并按区域行数预留；重绘开始时调用
+  void reset(int rows) {
+    if (static_cast<int>(spans.size()) < rows)
+      spans.resize(static_cast<size_t>(rows));
+    for (auto &row : spans)
+      row.clear();
+  }
+
+  // 第 row 行的 [x0, x1) 列对应 item
+  void add(int row, int item, int x0 = 0, int x1 = 1 << 30) {
+    if (row >= 0 && row < static_cast<int>(spans.size()))
+      spans[static_cast<size_t>(row)].push_back({x0, x1, item});
+  }
+
+  int at(int row, int x) const {
+    if (row < 0 || row >= static_cast<int>(spans.size()))
+      return none;
+    for (const Span &s : spans[static_cast<size_t>(row)])
+      if (x >= s.x0 && x < s.x1)
+        return s.item;
+    return none;
+  }
+
+private:
+  struct Span {
+    int x0, x1, item;
+  };
+  // 每行的向量在重绘间复用，稳定后不再分配
+  std::vector<std::vector<Span>> spans;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "Arch/icli/term_frame.h"
+#include "Arch/icli/term_session.h"
+
+/*
+ * Log lines streamed above the active prompt.
+ *
+ * push() may be called from any thread and never takes a lock: lines go
+ * into a bounded ring (a full ring drops the line instead of blocking the
+ * producer) and the owning session is woken at most once per flush
+ * through its atomic flag and wake fd. The session thread drains the ring
+ * no more often than maxFps, writes the lines above the prompt region,
+ * wrapped to the terminal width so every screen row is a frame row, and
+ * repaints the prompt once, so the cost per second is bounded by the
+ * frame rate rather than by the log rate.
+ */
+class LogPane {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // capacity 向上取整为 2 的幂；每次刷新最多写出 maxLines 行，多余的只计数
+  explicit LogPane(size_t capacity = 4096, int maxFps = 30, size_t maxLines = 256);
+  ~LogPane();
+
+  LogPane(const LogPane &) = delete;
+  LogPane &operator=(const LogPane &) = delete;
+
+  // 线程安全；缓冲区满时丢弃并返回 false
+  bool push(std::string line);
+
+  // 绑定需要唤醒的会话；会话结束前须以 nullptr 解绑，
+  // 返回时不再有 push() 使用旧会话
+  void attach(TermSession *term);
+
+  // === 以下仅在会话所在线程调用 ===
+  bool pending() const;
+  Clock::time_point nextFlush() const { return lastFlush + interval; }
+
+  // 取出缓冲中的行写入 out（按 out.width() 折行，每行以 \n 结尾），返回写出的日志行数
+  size_t drain(TermFrame &out);
+
+  // 因缓冲区满或单次刷新行数超限而未显示的行数
+  size_t skipped() const { return dropped.load(std::memory_order_relaxed) + elided; }
+
+private:
+  struct Slot {
+    std::atomic<size_t> seq;
+    std::string line;
+  };
+
+  std::unique_ptr<Slot[]> slots;
+  size_t mask;
+  alignas(64) std::atomic<size_t> head{0}; // 生产者写入位置
+  alignas(64) size_t tail = 0;             // 消费者读取位置
+  std::atomic<size_t> dropped{0};
+
+  std::atomic<bool> scheduled{false};
+  std::atomic<TermSession *> session{nullptr};
+  std::atomic<int> waking{0}; // 正在唤醒会话的 push() 个数
+
+  Clock::duration interval;
+  Clock::time_point lastFlush;
+  size_t maxLines;
+  size_t elided = 0;
+  size_t reported = 0; // 已在提示行中报告过的跳过行数
+};
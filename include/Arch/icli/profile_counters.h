@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Process-wide counters for profiling the prompt loop.
+ *
+ * The terminal layer always counts its write syscalls and termios calls
+ * (one relaxed increment next to a syscall costs nothing measurable).
+ * Heap allocations are only counted when the program links the
+ * arch_icli_alloc_count library, which wraps the global operator new and
+ * delete; allocationsCounted is true in that case.
+ *
+ * Take a ProfileSample before and after a piece of work and subtract to
+ * get its cost, e.g. per keystroke:
+ *
+ *   ProfileSample before = profile_sample();
+ *   cli.feed(term);
+ *   ProfileSample cost = profile_sample() - before;
+ */
+struct ProfileCounters {
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> allocatedBytes{0};
+  std::atomic<uint64_t> writes{0};       // 输出端的 write/send 调用
+  std::atomic<uint64_t> writtenBytes{0};
+  std::atomic<uint64_t> termiosCalls{0}; // tcgetattr / tcsetattr
+  std::atomic<bool> allocationsCounted{false};
+};
+
+// 常量初始化，可在全局 operator new 中安全使用
+inline ProfileCounters &profile_counters() {
+  static ProfileCounters counters;
+  return counters;
+}
+
+inline void profile_count(std::atomic<uint64_t> &counter, uint64_t n = 1) {
+  counter.fetch_add(n, std::memory_order_relaxed);
+}
+
+struct ProfileSample {
+  uint64_t allocations = 0;
+  uint64_t allocatedBytes = 0;
+  uint64_t writes = 0;
+  uint64_t writtenBytes = 0;
+  uint64_t termiosCalls = 0;
+
+  ProfileSample operator-(const ProfileSample &o) const {
+    return {allocations - o.allocations, allocatedBytes - o.allocatedBytes,
+            writes - o.writes, writtenBytes - o.writtenBytes,
+            termiosCalls - o.termiosCalls};
+  }
+};
+
+inline ProfileSample profile_sample() {
+  const ProfileCounters &c = profile_counters();
+  return {c.allocations.load(std::memory_order_relaxed),
+          c.allocatedBytes.load(std::memory_order_relaxed),
+          c.writes.load(std::memory_order_relaxed),
+          c.writtenBytes.load(std::memory_order_relaxed),
+          c.termiosCalls.load(std::memory_order_relaxed)};
+}
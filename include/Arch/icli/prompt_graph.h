@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+struct CLI_PROMPT;
+
+// 提示的回答：Yes/No 为 bool，输入为 string，单选为选项文本，多选为选中的选项文本，表格为行号
+using Answer = std::variant<std::monostate, bool, std::string,
+                            std::vector<std::string>, size_t>;
+
+/* Answers of the prompts accepted so far, keyed by node id */
+class Answers {
+public:
+  const Answer *find(const std::string &id) const {
+    auto it = values.find(id);
+    return it == values.end() ? nullptr : &it->second;
+  }
+
+  // 未回答或类型不符时为 nullptr
+  template <class T> const T *get(const std::string &id) const {
+    const Answer *answer = find(id);
+    return answer ? std::get_if<T>(answer) : nullptr;
+  }
+
+  bool equals(const std::string &id, bool value) const {
+    const bool *answer = get<bool>(id);
+    return answer && *answer == value;
+  }
+  bool equals(const std::string &id, const std::string &value) const {
+    const std::string *answer = get<std::string>(id);
+    return answer && *answer == value;
+  }
+  bool equals(const std::string &id, const char *value) const {
+    return equals(id, std::string(value));
+  }
+
+  // 多选回答中是否包含 option
+  bool contains(const std::string &id, const std::string &option) const;
+
+  void set(const std::string &id, Answer answer) { values[id] = std::move(answer); }
+  // 字符串字面量按 string 保存（否则 const char* 会隐式转换为 bool）
+  void set(const std::string &id, const char *value) { set(id, std::string(value)); }
+  void erase(const std::string &id) { values.erase(id); }
+
+private:
+  std::unordered_map<std::string, Answer> values;
+};
+
+/*
+ * Declarative prompt flow.
+ *
+ * Nodes are factories: a prompt is only constructed when the flow reaches
+ * it, and the factory can read earlier answers (e.g. to build its label or
+ * options). After a node is answered its outgoing edges are tried in the
+ * order they were added and the first whose condition holds is taken; a
+ * node with no matching edge ends the flow. A factory may return nullptr
+ * to skip its node: the flow follows the node's edges without an answer.
+ *
+ *   PromptGraph flow;
+ *   flow.node("docker", [](const Answers &) { return ...; })
+ *       .node("image", ...)
+ *       .node("done", ...)
+ *       .edge("docker", "image", [](const Answers &a) { return a.equals("docker", true); })
+ *       .edge("docker", "done");
+ */
+class PromptGraph {
+public:
+  using Factory = std::function<std::shared_ptr<CLI_PROMPT>(const Answers &)>;
+  using Condition = std::function<bool(const Answers &)>;
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  // 首个加入的节点为起点；重复的 id 覆盖之前的工厂
+  PromptGraph &node(const std::string &id, Factory make);
+  // 目标节点可以稍后再加入，始终没有加入的目标被忽略；when 为空表示无条件
+  PromptGraph &edge(const std::string &from, const std::string &to,
+                    Condition when = nullptr);
+
+  // 起点；还没有节点时为 npos
+  size_t start() const { return first; }
+  size_t size() const { return nodes.size(); }
+  size_t find(const std::string &id) const;
+  const std::string &id(size_t node) const { return nodes[node].id; }
+  std::shared_ptr<CLI_PROMPT> make(size_t node, const Answers &answers) const {
+    return nodes[node].make(answers);
+  }
+
+  // 回答 from 之后的下一个节点；流程结束为 npos
+  size_t next(size_t from, const Answers &answers) const;
+
+private:
+  struct Edge {
+    std::string to;
+    Condition when;
+  };
+  struct Node {
+    std::string id;
+    Factory make;
+    std::vector<Edge> edges;
+  };
+
+  Node &slot(const std::string &id);
+
+  // edge() 提前引用的 id 先占位，make 为空
+  std::vector<Node> nodes;
+  std::unordered_map<std::string, size_t> index;
+  size_t first = npos;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Arch/icli.h"
+#include "Arch/icli/term_session.h"
+
+/*
+ * Runs many Interactive_CLI sessions on a small, fixed pool of threads
+ * (Linux, epoll).
+ *
+ * Every fd is registered EPOLLONESHOT, so a session is only ever handled by
+ * one thread at a time and is re-armed after its event has been processed.
+ * A session finishes once its outcome is settled and its output has drained;
+ * then onDone runs on a pool thread and the session is destroyed.
+ */
+class SessionExecutor {
+public:
+  using DoneCallback = std::function<void(PromptResult)>;
+
+  explicit SessionExecutor(unsigned threads = std::thread::hardware_concurrency());
+  // 停止线程池；仍未结束的会话直接销毁，不调用 onDone，也不等待其积压输出
+  ~SessionExecutor();
+
+  SessionExecutor(const SessionExecutor &) = delete;
+  SessionExecutor &operator=(const SessionExecutor &) = delete;
+
+  // 可在任意线程（包括 onDone 中）调用
+  void add(std::unique_ptr<TermSession> term, std::unique_ptr<Interactive_CLI> cli,
+           DoneCallback onDone = nullptr);
+
+  size_t active() const;
+
+  // 阻塞到所有会话结束
+  void wait();
+
+private:
+  struct Entry;
+
+  void worker();
+  void handle(const std::shared_ptr<Entry> &entry, unsigned kind, uint32_t events);
+  void arm(Entry &entry, int op);
+
+  int epfd = -1;
+  int stopFd = -1;
+
+  mutable std::mutex mu;
+  std::condition_variable idle;
+  std::unordered_map<uint64_t, std::shared_ptr<Entry>> sessions;
+  uint64_t nextId = 1;
+
+  std::vector<std::thread> pool;
+};
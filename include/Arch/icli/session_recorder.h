@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Arch/icli/term_caps.h"
+
+/*
+ * Records a session's terminal I/O as an asciicast v2 file.
+ *
+ * input()/output() only append a small binary record to an in-memory
+ * buffer under a short lock; a background thread encodes the JSON lines
+ * and writes the file, so the render path never waits on disk. Data is
+ * stored as JSON strings; bytes that are not valid UTF-8 become U+FFFD.
+ */
+class SessionRecorder {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // caps 写入文件头（"arch_termcaps"），回放时据此固定子进程的终端能力
+  SessionRecorder(const std::string &path, int width, int height, const TermCaps &caps);
+  // 写出剩余事件并关闭文件
+  ~SessionRecorder();
+
+  SessionRecorder(const SessionRecorder &) = delete;
+  SessionRecorder &operator=(const SessionRecorder &) = delete;
+
+  // 文件无法打开时为 false，此时记录调用为空操作
+  bool ok() const { return file != nullptr; }
+
+  // 线程安全
+  void input(const char *data, size_t len) { record('i', data, len); }
+  void output(const char *data, size_t len) { record('o', data, len); }
+
+private:
+  void record(char kind, const char *data, size_t len);
+  void worker();
+  void encode(const std::string &records);
+
+  std::FILE *file = nullptr;
+  Clock::time_point start;
+
+  std::mutex mu;
+  std::condition_variable cv;
+  std::string buffer; // 待写出的二进制记录
+  bool stop = false;
+
+  // 仅工作线程使用：跨记录被截断的 UTF-8 尾字节
+  std::string carry[2];
+  std::string line;
+
+  std::thread thread;
+};
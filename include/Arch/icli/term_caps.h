@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+/* What the attached terminal understands beyond plain VT100 */
+struct TermCaps {
+  bool synchronizedOutput = false; // DEC mode 2026
+  bool bracketedPaste = false;     // DEC mode 2004
+  bool truecolor = false;          // 24-bit SGR colours
+  bool lineMotion = false;         // CNL/CPL/CHA (ECMA-48 cursor motion)
+};
+
+class TermSession;
+
+// Queries the terminal behind term through the session's own writer and
+// input fd; costs one round-trip, bounded by a short timeout. Keys typed
+// during the probe are handed back to the session. Only reports what the
+// terminal answered (no environment variables); answered is set when the
+// terminal replied to DA1 at all.
+TermCaps probe_term_caps(TermSession &term, bool *answered = nullptr);
+
+// Probes once per process, through term; answered probes are cached on
+// disk per $TERM. COLORTERM=truecolor/24bit is applied on top and never
+// cached.
+const TermCaps &term_caps(TermSession &term);
+
+// Cache file path for the current $TERM, empty if it cannot be determined
+std::string term_caps_cache_path();
+
+// Contents of a cache file describing caps ("key=0|1" per line)
+std::string format_term_caps(const TermCaps &caps);
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+
+#include "Arch/icli/term_caps.h"
+#include "Arch/icli/terminal_utils.h"
+
+/*
+ * Output buffer for one repaint of a session's prompt region.
+ *
+ * Rows are relative to the top of the region and the cursor row is tracked
+ * while text is appended, so every move is a relative one: no absolute
+ * screen position (and no cursor-position query) is ever needed, and each
+ * move uses the shortest sequence the terminal supports.
+ */
+class TermFrame {
+public:
+  // crlf：输出端没有 tty 行规程（socket 等）时自行把 \n 展开为 \r\n
+  TermFrame(const TermCaps &caps, int row, bool crlf = false, int columns = 80)
+      : caps(caps), row(row), crlf(crlf), columns(columns) {
+    // 一帧通常不足 1KB，一次分配代替逐步扩容
+    buf.reserve(1024);
+  }
+
+  TermFrame &moveTo(TermCoord pos) {
+    int dy = pos.Y - row;
+    if (pos.X == 0 && dy != 0 && caps.lineMotion) {
+      // CNL/CPL 同时回到行首
+      buf += "\033[" + param(dy > 0 ? dy : -dy) + (dy > 0 ? "E" : "F");
+    } else {
+      if (dy > 0)
+        buf += "\033[" + param(dy) + "B";
+      else if (dy < 0)
+        buf += "\033[" + param(-dy) + "A";
+
+      if (pos.X != col) {
+        if (pos.X == 0)
+          buf += "\r";
+        else if (caps.lineMotion)
+          buf += "\033[" + std::to_string(pos.X + 1) + "G";
+        else
+          buf += "\r\033[" + param(pos.X) + "C";
+      }
+    }
+    row = pos.Y;
+    col = pos.X;
+    return *this;
+  }
+
+  TermFrame &operator<<(const std::string &text) {
+    append(text.data(), text.size());
+    return *this;
+  }
+
+  TermFrame &operator<<(const char *text) {
+    append(text, std::char_traits<char>::length(text));
+    return *this;
+  }
+
+  int cursorRow() const { return row; }
+  // 终端列数，供提示按宽度排版
+  int width() const { return columns; }
+
+  const std::string &str() const { return buf; }
+
+private:
+  static std::string param(int n) { return n == 1 ? "" : std::to_string(n); }
+
+  void append(const char *text, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+      if (text[i] == '\n') {
+        // tty 输出开启 ONLCR，换行同时回到行首
+        if (crlf)
+          buf += '\r';
+        buf += '\n';
+        ++row;
+        col = 0;
+      } else if (text[i] == '\r') {
+        buf += '\r';
+        col = 0;
+      } else {
+        buf += text[i];
+        col = -1;
+      }
+    }
+  }
+
+  const TermCaps &caps;
+  std::string buf;
+  int row;
+  int col = -1; // -1 表示未知
+  bool crlf;
+  int columns;
+};
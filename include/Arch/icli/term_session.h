@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "Arch/icli/term_caps.h"
+#include "Arch/icli/session_recorder.h"
+#include "Arch/icli/term_frame.h"
+#include "Arch/icli/term_writer.h"
+#include "Arch/icli/terminal_utils.h"
+
+#ifndef _WIN32
+#include <termios.h>
+#endif
+
+/*
+ * Per-session terminal backend: the fds of one terminal plus everything
+ * that used to be process-global (output queue, input decoder, raw mode,
+ * cursor/region state). Any number of sessions can live in one process.
+ *
+ * The session keeps a "region" of rows for the active prompt. The cursor
+ * is always parked on the region's last row between frames, which is what
+ * makes skipped frames harmless: every frame starts from the same place.
+ */
+class TermSession {
+public:
+  // 不接管 fd 的所有权；非 tty 的 fd 在会话期间设为非阻塞，析构时恢复
+  TermSession(int in, int out, TermCaps caps = TermCaps());
+  // 恢复终端模式；积压输出最多等待 TermWriter::closeTimeoutMs，超时丢弃
+  ~TermSession();
+
+  TermSession(const TermSession &) = delete;
+  TermSession &operator=(const TermSession &) = delete;
+
+  int inFd() const { return in; }
+  int outFd() const { return writer.fd(); }
+  // 其他线程通过 wake() 唤醒会话时变为可读
+  int wakeFd() const { return wakeRead; }
+  // wakeAt() 的期限到达时变为可读（Linux timerfd，其他平台为 -1）
+  int timerFd() const { return timer; }
+
+  TermWriter &out() { return writer; }
+  const TermCaps &caps() const { return termCaps; }
+  // 在 Interactive_CLI::start() 之前设置（如探测结果）
+  void setCaps(const TermCaps &caps) { termCaps = caps; }
+  // 终端列数/行数；输出端不是终端时为 80x24。
+  // 终端会话在 SIGWINCH 后由 wait() 更新，并以 Woken 返回让提示按新宽度重绘
+  int width() const;
+  int lines() const;
+
+  // 录制之后的输入字节和实际写出的输出字节；传 nullptr 停止录制
+  void record(std::shared_ptr<SessionRecorder> recorder);
+
+  // === 输入 ===
+  enum : unsigned { InputReady = 1, Woken = 2 };
+
+  // 读入当前可读的字节；对端关闭时返回 false
+  bool readInput();
+  // 交还已从 fd 读出、不属于自己的字节（如探测终端能力时混入的预输入）
+  void pushInput(const std::string &bytes);
+  // 鼠标事件的坐标换算为相对提示区域（y 为区域行）；CPR 应答在此消费
+  bool nextKey(KeyEvent &evt);
+
+  // 开关 SGR 鼠标上报；区域位置未知时，鼠标事件被丢弃
+  void setMouse(bool on);
+
+  using Clock = std::chrono::steady_clock;
+
+  // 线程安全，可在任意线程调用
+  void wake();
+  // 在 when 时刻唤醒会话；只保留最早的期限，仅在会话所在线程调用
+  void wakeAt(Clock::time_point when);
+  // 清除唤醒标记和已到期的期限，返回此前是否被唤醒
+  bool consumeWake();
+
+  // 单会话阻塞等待：期间写出积压输出，返回 InputReady/Woken 位，超时为 0
+  unsigned wait(int timeout_ms);
+
+  // === 提示区域 ===
+  // 从当前光标位置开始构建一帧
+  TermFrame frame() const { return TermFrame(termCaps, height - 1, crlf, width()); }
+
+  // 在区域底部追加空行，直到区域至少有 rows 行
+  void reserveRows(int rows);
+
+  // 可丢弃的重绘；结束时光标回到区域最后一行。与上一帧相同时不写出
+  void present(TermFrame &frame);
+
+  // 定稿输出（问答记录）；之后光标所在行成为新区域的第一行
+  void commit(TermFrame &frame);
+
+  int rows() const { return height; }
+
+  // 会话开始以来定稿到区域上方的总行数
+  int transcriptRows() const { return committed; }
+  // 把区域上方最近 rows 行并回区域（区域首行上移），用于改写已定稿的记录；
+  // 这些行已滚出屏幕时返回 false，区域不变
+  bool reclaim(int rows);
+
+private:
+  int in;
+  TermWriter writer;
+  TermCaps termCaps;
+  KeyDecoder keys;
+  bool crlf = false;
+  std::shared_ptr<SessionRecorder> recorder;
+
+  int height = 1; // 区域行数，光标停在最后一行
+  int committed = 0;
+  std::string shown; // 上一次 present() 的帧，区域变化后清空
+
+  // 鼠标坐标是屏幕绝对位置：用一次 CPR 查询得到区域首行所在的屏幕行
+  void anchorStale();
+  // 重新读取窗口大小；区域需要整帧重绘
+  void resized();
+  bool mouse = false;
+  bool anchorKnown = false;
+  int anchorTop = 0;
+  int cprPending = 0; // 已发出、尚未收到应答的查询数
+  int cprIgnore = 0;  // 其中区域变化前发出、应答需丢弃的个数
+
+  // 不完整的转义序列最多等待这么久，之后按单独的 Esc 键处理
+  static constexpr std::chrono::milliseconds escTimeout{25};
+  bool escWaiting = false;
+  Clock::time_point escDeadline;
+
+  int wakeRead = -1;
+  int wakeWrite = -1;
+  std::atomic<bool> woken{false};
+
+  int timer = -1;
+  bool hasDeadline = false;
+  Clock::time_point deadline;
+
+#ifndef _WIN32
+  int cols = 80;
+  int screenRows = 24;
+  unsigned seenResize = 0;
+  bool rawMode = false;
+  struct termios saved;
+  int inFlags = -1; // 设为非阻塞之前的 fcntl 标志，-1 表示未改动
+  int outFlags = -1;
+#endif
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+/*
+ * Terminal output with frame skipping.
+ *
+ * Ordered output (transcript lines, mode switches) always reaches the
+ * terminal. Frames are full repaints of the live prompt region: while the
+ * terminal is still busy with earlier bytes only the newest frame is kept,
+ * so a slow pty or SSH link never makes input wait behind stale frames.
+ */
+class TermWriter {
+public:
+  explicit TermWriter(int fd);
+  ~TermWriter();
+
+  TermWriter(const TermWriter &) = delete;
+  TermWriter &operator=(const TermWriter &) = delete;
+
+  // Ordered bytes; written after anything already queued
+  void write(const std::string &bytes);
+
+  // Replaces any frame that has not started going out yet
+  void frame(std::string bytes);
+
+  // Writes what the fd accepts without blocking; true once nothing is left
+  bool pump();
+
+  // Blocks until every queued byte has been written, or for at most
+  // timeout_ms (-1: no limit). On timeout the unwritten backlog is dropped
+  // and false is returned, so a stalled peer cannot block shutdown; after
+  // that, flushes only write what the fd accepts without waiting.
+  bool flush(int timeout_ms = -1);
+
+  // 析构时等待积压写完的上限（对端不再读取时不会永远阻塞）
+  static constexpr int closeTimeoutMs = 1000;
+
+  bool backlog() const { return offset < queue.size() || hasPending; }
+
+  // fd to poll for POLLOUT while backlog() is true
+  int fd() const { return out; }
+
+  size_t droppedFrames() const { return dropped; }
+
+  // 包上 DEC 2026 同步更新标记，终端整帧呈现，不会显示半帧
+  void setSynchronized(bool enabled) { synchronized = enabled; }
+
+  // 每次成功写出后以实际写出的字节调用（录制等）；跳过的帧不会出现
+  using Observer = std::function<void(const char *data, size_t len)>;
+  void observe(Observer fn) { observer = std::move(fn); }
+
+private:
+  long send_bytes(const char *data, size_t len);
+  void discard();
+
+  int out;
+  bool owned = false;     // 为 tty 单独打开的非阻塞描述符
+  bool nonblocking = false;
+  bool synchronized = false;
+  bool socket = false;
+  bool stalled = false;   // 曾经 flush 超时：对端不再读取
+
+  std::string queue;      // 顺序输出及已开始写出的帧
+  size_t offset = 0;      // queue 中已写出的字节数
+  std::string pendingFrame;
+  bool hasPending = false;
+  size_t dropped = 0;
+  Observer observer;
+};
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
 #include <iostream>
+#include <string>
+#include <vector>
+#include "Arch/icli/profile_counters.h"
 
 // ANSI style wrappers for color and effects
 #define ANSI_RESET "\033[0m"
@@ -23,6 +29,8 @@
 #define UTF_VERTICAL_LINE u8"\u2502"
 #define UTF_CORNER_BOTTOM_LEFT u8"\u2514"
 #define UTF_TRIANGLE_UP u8"\u25B2"
+#define UTF_TRIANGLE_DOWN u8"\u25BC"
+#define UTF_POINTER u8"\u203A"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -30,6 +38,11 @@
 
 using TermCoord = COORD;
 
+// 光标定位的转义序列，用于拼接整帧输出
+inline std::string cursorTo(TermCoord pos) {
+  return "\033[" + std::to_string(pos.Y + 1) + ";" + std::to_string(pos.X + 1) + "H";
+}
+
 inline void setCursorVisible(bool visible) {
   HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
   CONSOLE_CURSOR_INFO info;
@@ -53,7 +66,10 @@ inline int getch_raw() {
 }
 
 #else  // POSIX
+#include <cerrno>
+#include <cstdio>
 #include <string>
+#include <poll.h>
 #include <unistd.h>
 #include <termios.h>
 #include <sys/ioctl.h>
@@ -63,49 +79,86 @@ struct TermCoord {
   int Y;
 };
 
+// 光标定位的转义序列，用于拼接整帧输出
+inline std::string cursorTo(TermCoord pos) {
+  return "\033[" + std::to_string(pos.Y + 1) + ";" + std::to_string(pos.X + 1) + "H";
+}
+
+// tcgetattr / tcsetattr(TCSANOW)，计入 profile_counters().termiosCalls
+inline int term_getattr(int fd, struct termios *attr) {
+  profile_count(profile_counters().termiosCalls);
+  return tcgetattr(fd, attr);
+}
+
+inline int term_setattr(int fd, const struct termios *attr) {
+  profile_count(profile_counters().termiosCalls);
+  return tcsetattr(fd, TCSANOW, attr);
+}
+
+/* Disables line buffering and echo for the lifetime of the scope */
+struct RawInputScope {
+  struct termios original;
+
+  RawInputScope() {
+    term_getattr(STDIN_FILENO, &original);
+    struct termios raw = original;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    term_setattr(STDIN_FILENO, &raw);
+  }
+  ~RawInputScope() { term_setattr(STDIN_FILENO, &original); }
+};
+
+// 直接读 fd 而不是 getchar()，避免字节滞留在 stdio 缓冲区里让 poll() 看不到
+inline int read_byte() {
+  unsigned char ch;
+  while (true) {
+    ssize_t n = read(STDIN_FILENO, &ch, 1);
+    if (n == 1)
+      return ch;
+    if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+      struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+      poll(&pfd, 1, -1);
+      continue;
+    }
+    return EOF;
+  }
+}
+
+// 以下辅助函数直接读写 stdin/stdout，不经过任何会话；
+// 交互提示通过 TermSession 读写，不使用它们
 inline void setCursorVisible(bool visible) {
   std::cout << (visible ? "\033[?25h" : "\033[?25l") << std::flush;
 }
 
 inline void moveCursorTo(TermCoord pos) {
-  std::cout << "\033[" << (pos.Y + 1) << ";" << (pos.X + 1) << "H" << std::flush;
+  std::cout << cursorTo(pos) << std::flush;
 }
 
 inline TermCoord getCursorPosition() {
-  struct termios original, raw;
-  tcgetattr(STDIN_FILENO, &original);
-  raw = original;
-  raw.c_lflag &= ~(ICANON | ECHO);
-  tcsetattr(STDIN_FILENO, TCSANOW, &raw);
-
+  RawInputScope raw;
   std::cout << "\033[6n" << std::flush;
-  char ch;
-  std::string response;
-
-  while (read(STDIN_FILENO, &ch, 1) == 1) {
-    response += ch;
-    if (ch == 'R') break;
-  }
-
-  tcsetattr(STDIN_FILENO, TCSANOW, &original);
 
-  int rows = 0, cols = 0;
-  if (sscanf(response.c_str(), "\033[%d;%dR", &rows, &cols) == 2) {
-    return TermCoord{cols - 1, rows - 1};
+  // 跳过应答前混入的字节，直到 CPR 应答
+  std::string seq;
+  int ch;
+  while ((ch = read_byte()) != EOF) {
+    if (ch == 27)
+      seq.assign(1, '\033');
+    else if (!seq.empty())
+      seq += static_cast<char>(ch);
+    if (seq.size() > 2 && ch >= 0x40 && ch <= 0x7e) {
+      int rows = 0, cols = 0;
+      if (ch == 'R' && sscanf(seq.c_str(), "\033[%d;%dR", &rows, &cols) == 2)
+        return TermCoord{cols - 1, rows - 1};
+      seq.clear();
+    }
   }
   return TermCoord{0, 0};
 }
 
 inline int getch_raw() {
-  struct termios oldt, newt;
-  int ch;
-  tcgetattr(STDIN_FILENO, &oldt);
-  newt = oldt;
-  newt.c_lflag &= ~(ICANON | ECHO);
-  tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-  ch = getchar();
-  tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
-  return ch;
+  RawInputScope raw;
+  return read_byte();
 }
 #endif
 
@@ -143,6 +196,191 @@ inline void clearAboveLine(TermCoord pos, int count) {
     clearLineAt(addY(pos, -i));
 }
 
+// === 显示宽度 ===
+// 解码 text[i] 起的一个 UTF-8 码点并前移 i；非法字节按 U+FFFD 计，只前移一字节
+inline uint32_t next_codepoint(const std::string &text, size_t &i) {
+  const unsigned char lead = static_cast<unsigned char>(text[i]);
+  size_t len = lead < 0x80 ? 1 : lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0;
+  if (len == 0 || i + len > text.size()) {
+    ++i;
+    return len == 1 ? lead : 0xFFFD;
+  }
+  uint32_t cp = len == 1 ? lead : lead & (0x7F >> len);
+  for (size_t k = 1; k < len; ++k) {
+    const unsigned char ch = static_cast<unsigned char>(text[i + k]);
+    if ((ch & 0xC0) != 0x80) {
+      ++i;
+      return 0xFFFD;
+    }
+    cp = cp << 6 | (ch & 0x3F);
+  }
+  i += len;
+  return cp;
+}
+
+// 码点占的终端列数（wcwidth）：组合符号、零宽字符为 0，
+// 东亚宽字符（CJK、谚文、全角形式、表情）为 2，其余为 1
+inline int codepoint_width(uint32_t cp) {
+  struct Range {
+    uint32_t first, last;
+  };
+  static const Range zero[] = {
+      {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x0610, 0x061A},
+      {0x064B, 0x065F}, {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF}, {0x200B, 0x200F},
+      {0x202A, 0x202E}, {0x2060, 0x2064}, {0x20D0, 0x20FF}, {0xFE00, 0xFE0F},
+      {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF}, {0xE0100, 0xE01EF}};
+  static const Range wide[] = {
+      {0x1100, 0x115F},   {0x231A, 0x231B},   {0x2329, 0x232A},
+      {0x23E9, 0x23EC},   {0x23F0, 0x23F0},   {0x23F3, 0x23F3},
+      {0x25FD, 0x25FE},   {0x2614, 0x2615},   {0x2648, 0x2653},
+      {0x267F, 0x267F},   {0x2693, 0x2693},   {0x26A1, 0x26A1},
+      {0x26AA, 0x26AB},   {0x26BD, 0x26BE},   {0x26C4, 0x26C5},
+      {0x26CE, 0x26CE},   {0x26D4, 0x26D4},   {0x26EA, 0x26EA},
+      {0x26F2, 0x26F3},   {0x26F5, 0x26F5},   {0x26FA, 0x26FA},
+      {0x26FD, 0x26FD},   {0x2705, 0x2705},   {0x270A, 0x270B},
+      {0x2728, 0x2728},   {0x274C, 0x274C},   {0x274E, 0x274E},
+      {0x2753, 0x2755},   {0x2757, 0x2757},   {0x2795, 0x2797},
+      {0x27B0, 0x27B0},   {0x27BF, 0x27BF},   {0x2B1B, 0x2B1C},
+      {0x2B50, 0x2B50},   {0x2B55, 0x2B55},   {0x2E80, 0x303E},
+      {0x3041, 0x33FF},   {0x3400, 0x4DBF},   {0x4E00, 0x9FFF},
+      {0xA000, 0xA4CF},   {0xA960, 0xA97F},   {0xAC00, 0xD7A3},
+      {0xF900, 0xFAFF},   {0xFE10, 0xFE19},   {0xFE30, 0xFE6F},
+      {0xFF00, 0xFF60},   {0xFFE0, 0xFFE6},   {0x16FE0, 0x16FE4},
+      {0x17000, 0x18CFF}, {0x1B000, 0x1B2FF}, {0x1F004, 0x1F004},
+      {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A},
+      {0x1F200, 0x1F251}, {0x1F300, 0x1F64F}, {0x1F680, 0x1F6FF},
+      {0x1F7E0, 0x1F7EB}, {0x1F90C, 0x1F9FF}, {0x1FA70, 0x1FAFF},
+      {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD}};
+  auto in = [cp](const Range *begin, const Range *end) {
+    const Range *it = std::upper_bound(begin, end, cp, [](uint32_t c, const Range &r) {
+      return c < r.first;
+    });
+    return it != begin && cp <= (it - 1)->last;
+  };
+  if (cp < 0x300)
+    return cp >= 0x20 && cp != 0x7F ? 1 : 0;
+  if (in(std::begin(zero), std::end(zero)))
+    return 0;
+  return in(std::begin(wide), std::end(wide)) ? 2 : 1;
+}
+
+// 终端显示的列数：按 codepoint_width 计，跳过 CSI 序列和控制字符
+inline size_t display_width(const std::string &text) {
+  size_t width = 0;
+  for (size_t i = 0; i < text.size();) {
+    unsigned char ch = static_cast<unsigned char>(text[i]);
+    if (ch == 27 && i + 1 < text.size() && text[i + 1] == '[') {
+      i += 2;
+      while (i < text.size() && (text[i] < 0x40 || text[i] > 0x7e))
+        ++i;
+      ++i;
+    } else {
+      width += static_cast<size_t>(codepoint_width(next_codepoint(text, i)));
+    }
+  }
+  return width;
+}
+
+// 截断或补齐纯文本到恰好 width 列，截断时以 … 结尾
+// （宽字符放不下 … 之前的最后一列时以空格补齐）
+inline std::string fit_width(const std::string &text, size_t width,
+                             bool alignRight = false) {
+  size_t len = display_width(text);
+  if (len <= width) {
+    std::string pad(width - len, ' ');
+    return alignRight ? pad + text : text + pad;
+  }
+  if (width == 0)
+    return "";
+  std::string out;
+  size_t cols = 0;
+  for (size_t i = 0; i < text.size();) {
+    size_t start = i;
+    size_t w = static_cast<size_t>(codepoint_width(next_codepoint(text, i)));
+    if (cols + w > width - 1)
+      break;
+    out.append(text, start, i - start);
+    cols += w;
+  }
+  return out + std::string(width - 1 - cols, ' ') + u8"\u2026";
+}
+
+// 把纯文本按单词折成每行不超过 width 列（按显示宽度计）；
+// 比一行还长的单词在行宽处断开，\n 强制换行
+inline std::vector<std::string> wrap_text(const std::string &text, size_t width) {
+  std::vector<std::string> lines;
+  if (width == 0)
+    return lines;
+  std::string line, word;
+  size_t lineCols = 0, wordCols = 0;
+
+  auto placeWord = [&] {
+    if (word.empty())
+      return;
+    if (lineCols > 0 && lineCols + 1 + wordCols > width) {
+      lines.push_back(line);
+      line.clear();
+      lineCols = 0;
+    }
+    if (wordCols > width) {
+      if (lineCols > 0) {
+        lines.push_back(line);
+        line.clear();
+        lineCols = 0;
+      }
+      // 逐段切下不超过行宽的部分，余下部分留作单词
+      size_t cols = 0, start = 0;
+      for (size_t i = 0; i < word.size();) {
+        size_t at = i;
+        size_t w = static_cast<size_t>(codepoint_width(next_codepoint(word, i)));
+        if (cols + w > width && cols > 0) {
+          lines.push_back(word.substr(start, at - start));
+          start = at;
+          wordCols -= cols;
+          cols = 0;
+        }
+        cols += w;
+      }
+      word.erase(0, start);
+    }
+    if (lineCols > 0) {
+      line += ' ';
+      ++lineCols;
+    }
+    line += word;
+    lineCols += wordCols;
+    word.clear();
+    wordCols = 0;
+  };
+
+  for (size_t i = 0; i < text.size();) {
+    const char c = text[i];
+    if (c == ' ' || c == '\t') {
+      placeWord();
+      ++i;
+    } else if (c == '\n') {
+      placeWord();
+      lines.push_back(line);
+      line.clear();
+      lineCols = 0;
+      ++i;
+    } else {
+      size_t start = i;
+      wordCols += static_cast<size_t>(codepoint_width(next_codepoint(text, i)));
+      word.append(text, start, i - start);
+    }
+  }
+  placeWord();
+  if (lineCols > 0)
+    lines.push_back(line);
+  return lines;
+}
+
+// 超出 width 列时截断并以 … 结尾，否则原样返回
+inline std::string clip_width(const std::string &text, size_t width) {
+  return display_width(text) <= width ? text : fit_width(text, width);
+}
+
 // === 键盘事件与解析 ===
 enum class Key {
   Unknown = -1,
@@ -155,11 +393,182 @@ enum class Key {
   ArrowRight,
   Escape,
   CtrlC,
+  PasteBegin, // bracketed paste 开始/结束标记
+  PasteEnd,
+  PageUp,
+  PageDown,
+  Home,
+  End,
+  BackTab, // Shift-Tab
+  // SGR 鼠标事件，x/y 为 0 起的列/行
+  MouseDown,
+  MouseUp,
+  MouseDrag,  // 按住按键移动；连续的拖动只保留最后一个
+  WheelUp,    // 连续的同向滚动合并，count 为格数
+  WheelDown,
+  CursorReport, // CPR 应答（\033[r;cR），x/y 为 0 起的光标位置
 };
 
 struct KeyEvent {
   Key key;
   char ch; // 仅当 key == Char 时有效
+  int x = 0, y = 0;  // 鼠标事件 / CPR
+  int button = 0;    // 0 左键，1 中键，2 右键
+  int count = 1;     // 合并的滚动格数
+  bool shift = false; // 方向键 / 鼠标事件带 Shift
+};
+
+inline bool is_mouse(Key key) {
+  return key >= Key::MouseDown && key <= Key::WheelDown;
+}
+
+/* Incremental decoder from raw terminal bytes to key events */
+class KeyDecoder {
+public:
+  void feed(const char *data, size_t len) {
+    if (head == buf.size()) {
+      buf.clear();
+      head = 0;
+    }
+    buf.append(data, len);
+  }
+
+  // idle 表示暂时没有更多字节，此时孤立的 ESC 视为 Escape 键
+  bool next(KeyEvent &evt, bool idle = true) {
+    if (!decode(evt, idle))
+      return false;
+
+    // 成批到达的拖动/滚动事件合并为一个，避免逐个重绘
+    if (evt.key == Key::MouseDrag || evt.key == Key::WheelUp ||
+        evt.key == Key::WheelDown) {
+      KeyEvent more;
+      size_t saved = head;
+      while (decode(more, idle) && more.key == evt.key &&
+             more.button == evt.button) {
+        if (evt.key == Key::MouseDrag)
+          evt = more;
+        else
+          evt.count += 1;
+        saved = head;
+      }
+      head = saved;
+    }
+    return true;
+  }
+
+  // 尚未解码的字节
+  std::string rest() const { return buf.substr(head); }
+  size_t buffered() const { return buf.size() - head; }
+
+private:
+  bool decode(KeyEvent &evt, bool idle) {
+    if (head == buf.size())
+      return false;
+
+    unsigned char ch1 = static_cast<unsigned char>(buf[head]);
+    size_t used = 1;
+    if (ch1 == 3) evt = {Key::CtrlC, 0};
+    else if (ch1 == 10 || ch1 == 13) evt = {Key::Enter, 0};
+    else if (ch1 == 127 || ch1 == 8) evt = {Key::Backspace, 0};
+    else if (ch1 != 27) evt = {Key::Char, static_cast<char>(ch1)};
+    else if (head + 1 == buf.size()) {
+      if (!idle)
+        return false;
+      evt = {Key::Escape, 0};
+    } else if (buf[head + 1] == '[' || buf[head + 1] == 'O') {
+      // CSI / SS3：参数字节直到 0x40–0x7E 范围内的结束字节
+      size_t end = head + 2;
+      char marker = 0;
+      int params[3] = {0, 0, 0};
+      int count = 0;
+      if (end < buf.size() && (buf[end] == '<' || buf[end] == '?'))
+        marker = buf[end++];
+      while (end < buf.size() && buf[end] >= 0x20 && buf[end] < 0x40) {
+        if (buf[end] >= '0' && buf[end] <= '9') {
+          if (count == 0)
+            count = 1;
+          if (count <= 3)
+            params[count - 1] = params[count - 1] * 10 + (buf[end] - '0');
+        } else if (buf[end] == ';') {
+          count = count ? count + 1 : 2;
+        }
+        ++end;
+      }
+      if (end == buf.size()) {
+        if (!idle)
+          return false;
+        evt = {Key::Escape, 0};
+      } else if (buf[end] == 'M' && !marker && count == 0 && buf[head + 1] == '[') {
+        // 旧式 X10 鼠标编码：后跟 3 个原始字节，整体跳过
+        if (end + 3 >= buf.size() && !idle)
+          return false;
+        used = std::min(end + 4, buf.size()) - head;
+        evt = {Key::Unknown, 0};
+      } else {
+        used = end - head + 1;
+        evt = csi(buf[end], marker, params, count);
+      }
+    } else {
+      evt = {Key::Escape, 0};
+    }
+
+    head += used;
+    return true;
+  }
+
+  static KeyEvent csi(char final, char marker, const int *params, int count) {
+    if (marker == '<' && (final == 'M' || final == 'm') && count >= 3) {
+      // SGR 鼠标：\033[<b;x;yM 按下/移动，m 释放
+      KeyEvent evt = {Key::MouseDown, 0};
+      int b = params[0];
+      evt.x = params[1] - 1;
+      evt.y = params[2] - 1;
+      evt.button = b & 3;
+      evt.shift = (b & 4) != 0;
+      if (b & 64)
+        evt.key = (b & 1) ? Key::WheelDown : Key::WheelUp;
+      else if (b & 32)
+        evt.key = Key::MouseDrag;
+      else if (final == 'm')
+        evt.key = Key::MouseUp;
+      return evt;
+    }
+    if (marker)
+      return {Key::Unknown, 0};
+
+    // \033[1;<m>A：第二个参数为 1 + 修饰键位，Shift 为 1
+    KeyEvent evt = {Key::Unknown, 0};
+    evt.shift = count >= 2 && params[1] > 1 && ((params[1] - 1) & 1);
+    switch (final) {
+      case 'A': evt.key = Key::ArrowUp; return evt;
+      case 'B': evt.key = Key::ArrowDown; return evt;
+      case 'C': evt.key = Key::ArrowRight; return evt;
+      case 'D': evt.key = Key::ArrowLeft; return evt;
+      case 'H': evt.key = Key::Home; return evt;
+      case 'F': evt.key = Key::End; return evt;
+      case 'Z': return {Key::BackTab, 0};
+      case 'R': {
+        if (count < 2)
+          return {Key::Unknown, 0};
+        evt = {Key::CursorReport, 0};
+        evt.y = params[0] - 1;
+        evt.x = params[1] - 1;
+        return evt;
+      }
+      case '~':
+        if (params[0] == 200) return {Key::PasteBegin, 0};
+        if (params[0] == 201) return {Key::PasteEnd, 0};
+        if (params[0] == 5) evt.key = Key::PageUp;
+        else if (params[0] == 6) evt.key = Key::PageDown;
+        else if (params[0] == 1 || params[0] == 7) evt.key = Key::Home;
+        else if (params[0] == 4 || params[0] == 8) evt.key = Key::End;
+        return evt;
+      default: return {Key::Unknown, 0};
+    }
+  }
+
+  std::string buf;
+  size_t head = 0;
 };
 
 inline KeyEvent get_key_event() {
@@ -174,6 +583,11 @@ inline KeyEvent get_key_event() {
       case 80: return {Key::ArrowDown, 0};
       case 75: return {Key::ArrowLeft, 0};
       case 77: return {Key::ArrowRight, 0};
+      case 73: return {Key::PageUp, 0};
+      case 81: return {Key::PageDown, 0};
+      case 71: return {Key::Home, 0};
+      case 79: return {Key::End, 0};
+      case 15: return {Key::BackTab, 0};
       default: return {Key::Unknown, 0};
     }
   } else if (ch1 == 13) return {Key::Enter, 0};
@@ -181,22 +595,21 @@ inline KeyEvent get_key_event() {
   else if (ch1 == 27) return {Key::Escape, 0};
   else return {Key::Char, static_cast<char>(ch1)};
 #else
-  if (ch1 == 3) return {Key::CtrlC, 0};
-  if (ch1 == 27) {
-    char seq1 = getchar();
-    if (seq1 == '[') {
-      char seq2 = getchar();
-      switch (seq2) {
-        case 'A': return {Key::ArrowUp, 0};
-        case 'B': return {Key::ArrowDown, 0};
-        case 'C': return {Key::ArrowRight, 0};
-        case 'D': return {Key::ArrowLeft, 0};
-        default: return {Key::Unknown, 0};
-      }
-    }
-    return {Key::Escape, 0};
-  } else if (ch1 == 10 || ch1 == 13) return {Key::Enter, 0};
-  else if (ch1 == 127) return {Key::Backspace, 0};
-  else return {Key::Char, static_cast<char>(ch1)};
+  // 逐字节喂给解码器；序列的后续字节总是随首字节一起到达
+  RawInputScope raw;
+  KeyDecoder decoder;
+  KeyEvent evt;
+  int ch = ch1;
+  while (true) {
+    if (ch == EOF)
+      return {Key::Unknown, 0};
+    char byte = static_cast<char>(ch);
+    decoder.feed(&byte, 1);
+    // 没有紧随的字节时按完整序列解码（单独的 Esc 等）
+    struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+    if (decoder.next(evt, poll(&pfd, 1, 0) <= 0))
+      return evt;
+    ch = read_byte();
+  }
 #endif
 }
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Arch/icli/terminal_utils.h"
+
+/*
+ * Wrapped lines of a list of texts (e.g. option descriptions), laid out
+ * lazily per item and kept until the width changes, so repaints reuse the
+ * layout and only a terminal resize reflows it.
+ */
+class WrapCache {
+public:
+  const std::vector<std::string> &lines(size_t item, const std::string &text,
+                                        size_t width) {
+    if (item >= entries.size())
+      entries.resize(item + 1);
+    Entry &entry = entries[item];
+    if (!entry.valid || entry.width != width) {
+      entry.lines = wrap_text(text, width);
+      entry.width = width;
+      entry.valid = true;
+    }
+    return entry.lines;
+  }
+
+  // 文本内容或顺序改变后调用
+  void clear() { entries.clear(); }
+
+private:
+  struct Entry {
+    bool valid = false;
+    size_t width = 0;
+    std::vector<std::string> lines;
+  };
+  std::vector<Entry> entries;
+};
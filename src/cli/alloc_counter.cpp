@@ -0,0 +1,54 @@
+#include <cstdlib>
+#include <new>
+
+#include "Arch/icli/profile_counters.h"
+
+/*
+ * Counting replacement of the global allocation functions.
+ *
+ * Built as its own object library (arch_icli_alloc_count) so only programs
+ * that ask for it pay for the counting; linking it replaces operator new
+ * and delete for the whole program. Over-aligned allocations keep the
+ * library's implementation and are not counted.
+ */
+
+static void *counted_alloc(std::size_t size) {
+  ProfileCounters &c = profile_counters();
+  profile_count(c.allocations);
+  profile_count(c.allocatedBytes, size);
+  // malloc(0) 可能返回空指针，new 必须返回唯一的非空指针
+  return std::malloc(size ? size : 1);
+}
+
+// 链接了本库时标记计数有效
+static const bool counted = [] {
+  profile_counters().allocationsCounted.store(true, std::memory_order_relaxed);
+  return true;
+}();
+
+void *operator new(std::size_t size) {
+  if (void *p = counted_alloc(size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+  if (void *p = counted_alloc(size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return counted_alloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return counted_alloc(size);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
@@ -0,0 +1,263 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+#include "Arch/icli/answer_store.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char MAGIC[8] = {'A', 'R', 'C', 'H', 'A', 'N', 'S', '1'};
+static const uint32_t VERSION = 1;
+
+// 线性探测的窗口；窗口内没有空位时替换最久未用的槽位
+static const size_t PROBES = 8;
+// 分数的半衰期（以回答次数计）
+static const double HALF_LIFE = 16;
+
+enum : uint8_t { KindText = 1, KindUsage = 2 };
+
+struct AnswerStore::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t slots;
+  uint64_t clock; // 逻辑时钟：每记录一个提示的回答（beginAnswer）加一
+  char reserved[40];
+};
+
+struct AnswerStore::Slot {
+  uint64_t hash; // 0 为空槽
+  uint64_t stamp;
+  uint64_t last;
+  uint32_t count;
+  uint8_t kind;
+  uint8_t chosen;
+  uint16_t keyLen;
+  uint16_t valueLen;
+  char data[222]; // 键，随后是值
+};
+
+// FNV-1a；种类也参与散列，同名的文本和选项记录互不冲突
+static uint64_t hash_key(uint8_t kind, const std::string &key) {
+  uint64_t h = 1469598103934665603ull ^ kind;
+  for (unsigned char c : key) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  return h ? h : 1;
+}
+
+// 文件内容不可信：种类未知或长度越出槽位的视为空槽
+static bool slot_valid(uint8_t kind, uint16_t keyLen, uint16_t valueLen, size_t room) {
+  return (kind == KindText || kind == KindUsage) &&
+         static_cast<size_t>(keyLen) + valueLen <= room;
+}
+
+// 选项记录的键：提示键 + 单元分隔符 + 选项
+static std::string usage_key(const std::string &key, const std::string &option) {
+  return key + '\x1f' + option;
+}
+
+#ifdef _WIN32
+// Windows 上暂不持久化：存储始终不可用
+AnswerStore::AnswerStore(const std::string &, size_t) {}
+AnswerStore::~AnswerStore() = default;
+#else
+AnswerStore::AnswerStore(const std::string &path, size_t slotCount) {
+  static_assert(sizeof(Header) == 64, "header layout");
+  static_assert(sizeof(Slot) == 256, "slot layout");
+
+  std::error_code ec;
+  std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return;
+  }
+
+  size_t count = 16;
+  while (count < slotCount)
+    count <<= 1;
+  bool fresh = st.st_size == 0;
+  size_t size = fresh ? sizeof(Header) + count * sizeof(Slot)
+                      : static_cast<size_t>(st.st_size);
+  if ((fresh && ftruncate(fd, static_cast<off_t>(size)) != 0) ||
+      size < sizeof(Header)) {
+    ::close(fd);
+    return;
+  }
+
+  void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+    return;
+
+  Header *head = static_cast<Header *>(map);
+  if (fresh) {
+    // ftruncate 得到的是全零文件，只需写头
+    std::memcpy(head->magic, MAGIC, sizeof(MAGIC));
+    head->version = VERSION;
+    head->slots = static_cast<uint32_t>(count);
+  }
+  // 只校验文件头，不解析内容
+  const size_t slots = head->slots;
+  if (std::memcmp(head->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      head->version != VERSION || slots == 0 || (slots & (slots - 1)) != 0 ||
+      size != sizeof(Header) + slots * sizeof(Slot)) {
+    munmap(map, size);
+    return;
+  }
+
+  header = head;
+  this->slots = reinterpret_cast<Slot *>(head + 1);
+  mask = slots - 1;
+  mapped = size;
+}
+
+AnswerStore::~AnswerStore() {
+  if (header)
+    munmap(header, mapped);
+}
+#endif
+
+AnswerStore::Slot *AnswerStore::lookup(uint8_t kind, const std::string &key) const {
+  const uint64_t hash = hash_key(kind, key);
+  for (size_t i = 0; i < PROBES; ++i) {
+    Slot &slot = slots[(hash + i) & mask];
+    // 空槽和无效槽之后仍可能有该键（槽位曾被清空或损坏），查完整个窗口
+    if (slot.hash == 0 ||
+        !slot_valid(slot.kind, slot.keyLen, slot.valueLen, sizeof(Slot::data)))
+      continue;
+    if (slot.hash == hash && slot.kind == kind && slot.keyLen == key.size() &&
+        std::memcmp(slot.data, key.data(), key.size()) == 0)
+      return &slot;
+  }
+  return nullptr;
+}
+
+AnswerStore::Slot *AnswerStore::insert(uint8_t kind, const std::string &key) {
+  if (key.size() > sizeof(Slot::data))
+    return nullptr;
+  if (Slot *slot = lookup(kind, key))
+    return slot;
+
+  // 键不在窗口内：优先用第一个空槽或无效槽，否则替换最久未用的槽位
+  const uint64_t hash = hash_key(kind, key);
+  Slot *oldest = nullptr;
+  for (size_t i = 0; i < PROBES; ++i) {
+    Slot &slot = slots[(hash + i) & mask];
+    if (slot.hash == 0 ||
+        !slot_valid(slot.kind, slot.keyLen, slot.valueLen, sizeof(Slot::data))) {
+      oldest = &slot;
+      break;
+    }
+    if (!oldest || slot.stamp < oldest->stamp)
+      oldest = &slot;
+  }
+
+  std::memset(oldest, 0, sizeof(Slot));
+  oldest->hash = hash;
+  oldest->kind = kind;
+  oldest->keyLen = static_cast<uint16_t>(key.size());
+  std::memcpy(oldest->data, key.data(), key.size());
+  return oldest;
+}
+
+void AnswerStore::beginAnswer() {
+  usageWrites = 0;
+  if (header)
+    ++header->clock;
+}
+
+// 没有调用过 beginAnswer() 时时钟为 0，而 last 为 0 表示从未选中
+uint64_t AnswerStore::now() {
+  if (header->clock == 0)
+    header->clock = 1;
+  return header->clock;
+}
+
+bool AnswerStore::text(const std::string &key, std::string &value) const {
+  if (!header)
+    return false;
+  const Slot *slot = lookup(KindText, key);
+  if (!slot)
+    return false;
+  value.assign(slot->data + slot->keyLen, slot->valueLen);
+  return true;
+}
+
+void AnswerStore::setText(const std::string &key, const std::string &value) {
+  if (!header || key.size() + value.size() > sizeof(Slot::data))
+    return;
+  Slot *slot = insert(KindText, key);
+  if (!slot)
+    return;
+  slot->stamp = now();
+  slot->valueLen = static_cast<uint16_t>(value.size());
+  std::memcpy(slot->data + slot->keyLen, value.data(), value.size());
+}
+
+AnswerStore::Usage AnswerStore::usage(const std::string &key,
+                                      const std::string &option) const {
+  Usage result;
+  if (!header)
+    return result;
+  const std::string full = usage_key(key, option);
+  if (const Slot *slot = lookup(KindUsage, full)) {
+    result.count = slot->count;
+    result.last = slot->last;
+    result.chosen = slot->chosen != 0;
+  }
+  return result;
+}
+
+void AnswerStore::choose(const std::string &key, const std::string &option,
+                         bool chosen) {
+  if (!header)
+    return;
+  const std::string full = usage_key(key, option);
+  if (!chosen) {
+    // 未选中的选项不占新槽位
+    if (Slot *slot = lookup(KindUsage, full))
+      slot->chosen = 0;
+    return;
+  }
+  // 选中项很多时只记住前面一部分，不挤掉其他提示的记录
+  if (usageWrites >= maxUsagePerAnswer)
+    return;
+  Slot *slot = insert(KindUsage, full);
+  if (!slot)
+    return;
+  ++usageWrites;
+  slot->stamp = slot->last = now();
+  slot->count += 1;
+  slot->chosen = 1;
+}
+
+double AnswerStore::score(const Usage &usage) const {
+  if (!header || usage.count == 0)
+    return 0;
+  double age = static_cast<double>(header->clock - usage.last);
+  return usage.count * std::exp2(-age / HALF_LIFE);
+}
+
+std::string AnswerStore::defaultPath(const std::string &name) {
+  std::string dir;
+  if (const char *xdg = std::getenv("XDG_STATE_HOME"); xdg && *xdg)
+    dir = xdg;
+  else if (const char *home = std::getenv("HOME"); home && *home)
+    dir = std::string(home) + "/.local/state";
+  else
+    return "";
+  return dir + "/arch/answers/" + name;
+}
@@ -0,0 +1,82 @@
+#include <string>
+#include <utility>
+
+#include "Arch/icli/async_validator.h"
+
+AsyncValidator::AsyncValidator(InputValidator fn,
+                               std::chrono::milliseconds debounce,
+                               std::function<void()> notify)
+    : fn(std::move(fn)), debounce(debounce), notify(std::move(notify)),
+      thread(&AsyncValidator::worker, this) {}
+
+AsyncValidator::~AsyncValidator() {
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    stop = true;
+    // 让正在运行的校验尽早看到取消
+    latest.fetch_add(1, std::memory_order_relaxed);
+  }
+  cv.notify_all();
+  thread.join();
+}
+
+void AsyncValidator::submit(std::string value) {
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    pendingValue = std::move(value);
+    deadline = Clock::now() + debounce;
+    pending = true;
+    latest.fetch_add(1, std::memory_order_relaxed);
+  }
+  cv.notify_all();
+}
+
+bool AsyncValidator::ready() const {
+  std::lock_guard<std::mutex> lock(mu);
+  return resultGeneration == latest.load(std::memory_order_relaxed);
+}
+
+std::string AsyncValidator::message() const {
+  std::lock_guard<std::mutex> lock(mu);
+  return result;
+}
+
+void AsyncValidator::flush() {
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    skipDebounce = pending;
+  }
+  cv.notify_all();
+}
+
+void AsyncValidator::worker() {
+  std::unique_lock<std::mutex> lock(mu);
+  while (true) {
+    cv.wait(lock, [this] { return stop || pending; });
+    if (stop)
+      return;
+
+    // 防抖：每次 submit 都会推迟 deadline
+    while (!stop && !skipDebounce && Clock::now() < deadline)
+      cv.wait_until(lock, deadline);
+    if (stop)
+      return;
+
+    std::string value = std::move(pendingValue);
+    ValidationToken token{latest.load(std::memory_order_relaxed), &latest};
+    pending = false;
+    skipDebounce = false;
+
+    lock.unlock();
+    std::string msg = fn(value, token);
+    lock.lock();
+
+    // 过期代次的结果直接丢弃
+    if (!token.cancelled()) {
+      result = std::move(msg);
+      resultGeneration = token.generation;
+      if (notify)
+        notify();
+    }
+  }
+}
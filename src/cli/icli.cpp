@@ -1,9 +1,16 @@
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <cstdlib>
+#include <numeric>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "Arch/icli/term_caps.h"
+#include "Arch/icli/term_frame.h"
+#include "Arch/icli/term_session.h"
 #include "Arch/icli/terminal_utils.h"
 #include "Arch/icli.h"
 
@@ -25,94 +32,220 @@ inline std::string ICON_CHECKBOX(const bool selected) {
   return selected ? ANSI_GREEN(UTF_BLOCK_FILLED) : ANSI_GREEN(UTF_BOX_EMPTY);
 }
 
-void CLI_PromptContinue::prompt(const TermCoord pos) const {
-  moveCursorTo(pos);
+// "│  ◉ Yes / ○ No" 中两个选项所占的列
+inline void HIT_BOOLEAN(HitMap &hits) {
+  hits.reset(3);
+  hits.add(1, Yes, 3, 8);
+  hits.add(1, No, 11, 15);
+}
 
-  std::cout << ANSI_BLUE(UTF_VERTICAL_LINE) << "  ";
-  std::cout << ICON_BOOLEAN(choice == Yes, "Yes") << ANSI_DIM(" / ")
-      << ICON_BOOLEAN(choice == No, "No");
-  std::cout << "\n" << ANSI_BLUE(UTF_CORNER_BOTTOM_LEFT);
+// 左键按下/拖动移动高亮，在高亮项上松开算一次点击；返回被点击的项
+static int track_click(const HitMap &hits, int &pressed, int &highlight,
+                       const KeyEvent &evt, bool &changed) {
+  const int item = hits.at(evt.y, evt.x);
+  switch (evt.key) {
+    case Key::MouseDown:
+      pressed = evt.button == 0 ? item : HitMap::none;
+      [[fallthrough]];
+    case Key::MouseDrag:
+      if (pressed != HitMap::none && item != HitMap::none && item != highlight) {
+        highlight = item;
+        changed = true;
+      }
+      return HitMap::none;
+    case Key::MouseUp: {
+      bool click = pressed != HitMap::none && item != HitMap::none && item == highlight;
+      pressed = HitMap::none;
+      return click ? item : HitMap::none;
+    }
+    default:
+      return HitMap::none;
+  }
+}
 
-  std::cout << "\033[K";
-  std::cout.flush();
+// 让 index 落在 [top, top + page) 内
+static void keep_visible(int &top, int index, int page) {
+  if (index < top)
+    top = index;
+  else if (index >= top + page)
+    top = index - page + 1;
 }
 
-bool CLI_PromptContinue::run(bool isLastPrompt) {
-  std::cout << ICON_PROMPT(state) << "  " << label << "\n";
-  std::cout << UTF_VERTICAL_LINE << "\n";
+// 滚轮按合并后的格数移动视口，选中项随之留在视口内
+static bool scroll_wheel(int &top, int &index, int count, int page,
+                         const KeyEvent &evt) {
+  int step = evt.key == Key::WheelUp ? -evt.count : evt.count;
+  int newTop = std::max(0, std::min(top + step, count - page));
+  int newIndex = std::max(newTop, std::min(index, newTop + page - 1));
+  if (newTop == top && newIndex == index)
+    return false;
+  top = newTop;
+  index = newIndex;
+  return true;
+}
 
-  TermCoord pos = getCursorPosition();
-  pos.Y -= 1;
+// 按记忆的使用情况稳定重排选项（没有记录的保持原顺序排在后面），
+// extra 随选项一起重排；返回重排后每个选项的使用记录
+template <class Extra>
+static std::vector<AnswerStore::Usage>
+rank_options(const AnswerStore &store, const std::string &key, bool reorder,
+             std::vector<Option> &options, std::vector<Extra> &extra) {
+  const size_t n = options.size();
+  std::vector<AnswerStore::Usage> usage(n);
+  std::vector<double> score(n);
+  for (size_t i = 0; i < n; ++i) {
+    usage[i] = store.usage(key, options[i].option);
+    score[i] = store.score(usage[i]);
+  }
+  if (!reorder)
+    return usage;
+
+  std::vector<size_t> order(n);
+  std::iota(order.begin(), order.end(), size_t(0));
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return score[a] > score[b]; });
+
+  std::vector<Option> sortedOptions;
+  std::vector<Extra> sortedExtra;
+  std::vector<AnswerStore::Usage> sortedUsage;
+  sortedOptions.reserve(n);
+  for (size_t i : order) {
+    sortedOptions.push_back(std::move(options[i]));
+    if (i < extra.size())
+      sortedExtra.push_back(extra[i]);
+    sortedUsage.push_back(usage[i]);
+  }
+  options = std::move(sortedOptions);
+  extra = std::move(sortedExtra);
+  return sortedUsage;
+}
 
-  while (true) {
-    prompt(pos);
+// 从 row 行起画 rows 行的描述面板；折行结果只在宽度变化时重算
+static void DESCRIPTION_PANEL(TermFrame &out, int row, int rows, const std::string &bar,
+                              WrapCache &cache, size_t item, const std::string &text) {
+  // "│    " 之后的可用宽度，留出最后一列避免终端自动换行
+  const size_t width = static_cast<size_t>(std::max(out.width() - 6, 1));
+  const std::vector<std::string> &lines = cache.lines(item, text, width);
+  for (int i = 0; i < rows; ++i) {
+    out.moveTo(TermCoord{0, static_cast<decltype(TermCoord::Y)>(row + i)});
+    out << bar << "    ";
+    if (static_cast<size_t>(i) < lines.size()) {
+      std::string line = lines[i];
+      // 放不下的部分以 … 表示
+      if (i == rows - 1 && lines.size() > static_cast<size_t>(rows))
+        line = display_width(line) < width ? line + u8"\u2026" : fit_width(line, width - 1);
+      out << ANSI_DIM(line);
+    }
+    out << "\033[K";
+  }
+}
 
-    KeyEvent evt = get_key_event();
+static bool has_description(const std::vector<Option> &options) {
+  return std::any_of(options.begin(), options.end(),
+                     [](const Option &o) { return !o.description.empty(); });
+}
 
-    if (evt.key == Key::ArrowLeft) {
-      choice = Yes;
-    } else if (evt.key == Key::ArrowRight) {
-      choice = No;
-    } else if (evt.key == Key::Enter) {
-      state = (choice == Yes) ? PromptState::Succeed : PromptState::Failed;
-
-      // 清除选择和底线行
-      clearLineAt(pos);
-      TermCoord below = pos;
-      below.Y += 1;
-      clearLineAt(below);
-
-      // 重绘首行图标
-      TermCoord top = pos;
-      top.Y -= 1;
-      moveCursorTo(top);
-      std::cout << ICON_PROMPT(state) << "  " << label << "\033[K";
-
-      // 显示选择结果
-      if (choice == Yes) {
-        std::cout << "\n"
-            << UTF_VERTICAL_LINE << "  " << ANSI_DIM("Yes") << "\n"
-            << UTF_VERTICAL_LINE << "\n";
-      } else {
-        std::cout << "\n"
-            << UTF_VERTICAL_LINE << "  " << ANSI_DIM("No") << "\n"
-            << UTF_VERTICAL_LINE << "\n"
-            << UTF_CORNER_BOTTOM_LEFT << ANSI_RED("  Exiting.")
-            << "\n\n";
-        setCursorVisible(true);
-        exit(0);
-      }
-      return choice == Yes;
+// 列表超出一页时在底线显示可见范围
+static std::string VIEW_RANGE(int top, int page, size_t count) {
+  if (count <= static_cast<size_t>(page))
+    return "";
+  return ANSI_DIM("  " + std::to_string(top + 1) + "-" +
+                  std::to_string(top + page) + " of " + std::to_string(count));
+}
 
-    } else if (evt.key == Key::Escape || (evt.key == Key::CtrlC)) {
-      state = PromptState::Failed;
+void CLI_PromptContinue::prompt(TermFrame &out) const {
+  HIT_BOOLEAN(hits);
+  out.moveTo(TermCoord{0, 0});
+  out << ICON_PROMPT(state) << "  " << label << "\033[K";
 
-      // 清除选择和底线行
-      clearLineAt(pos);
-      TermCoord below = pos;
-      below.Y += 1;
-      clearLineAt(below);
-
-      // 重绘首行图标为失败
-      TermCoord top = pos;
-      top.Y -= 1;
-      moveCursorTo(top);
-      std::cout << ICON_PROMPT(state) << "  " << label << "\033[K";
-
-      // 显示取消状态
-      std::cout << "\n"
-          << UTF_VERTICAL_LINE << "  "
-          << ANSI_CANCELLED((choice == Yes ? "Yes" : "No")) << "\n"
-          << UTF_VERTICAL_LINE << "\n"
-          << UTF_CORNER_BOTTOM_LEFT << ANSI_RED("  Exiting.") << "\n\n";
-      setCursorVisible(true);
-      exit(1);
-    }
+  out.moveTo(TermCoord{0, 1});
+  out << ANSI_BLUE(UTF_VERTICAL_LINE) << "  ";
+  out << ICON_BOOLEAN(choice == Yes, "Yes") << ANSI_DIM(" / ")
+      << ICON_BOOLEAN(choice == No, "No");
+  out << "\033[K\n" << ANSI_BLUE(UTF_CORNER_BOTTOM_LEFT);
+
+  out << "\033[K";
+}
+
+PromptResult CLI_PromptContinue::handle(TermSession &, const KeyEvent &evt) {
+  if (evt.key == Key::ArrowLeft) {
+    choice = Yes;
+  } else if (evt.key == Key::ArrowRight) {
+    choice = No;
+  } else if (evt.key == Key::Enter) {
+    state = (choice == Yes) ? PromptState::Succeed : PromptState::Failed;
+    return choice == Yes ? PromptResult::Accepted : PromptResult::Declined;
+  } else if (evt.key == Key::Escape || (evt.key == Key::CtrlC)) {
+    state = PromptState::Failed;
+    return PromptResult::Cancelled;
   }
+  return PromptResult::Pending;
 }
 
-void CLI_PromptInput::prompt(TermCoord pos) const {
-  moveCursorTo(pos);
+PromptResult CLI_PromptContinue::handleMouse(TermSession &, const KeyEvent &evt,
+                                             bool &changed) {
+  int highlight = choice;
+  int clicked = track_click(hits, pressed, highlight, evt, changed);
+  choice = static_cast<BooleanChoice>(highlight);
+  if (clicked == HitMap::none)
+    return PromptResult::Pending;
+  state = (choice == Yes) ? PromptState::Succeed : PromptState::Failed;
+  return choice == Yes ? PromptResult::Accepted : PromptResult::Declined;
+}
+
+void CLI_PromptContinue::recall(const AnswerStore &store, const std::string &key) {
+  std::string last;
+  if (store.text(key, last))
+    choice = last == "No" ? No : Yes;
+}
+
+void CLI_PromptContinue::remember(AnswerStore &store, const std::string &key) const {
+  store.setText(key, choice == Yes ? "Yes" : "No");
+}
+
+void CLI_PromptContinue::finish(TermFrame &out, PromptResult result) {
+  out << ICON_PROMPT(state) << "  " << label;
+
+  // 显示选择结果
+  if (result == PromptResult::Accepted) {
+    out << "\n"
+        << UTF_VERTICAL_LINE << "  " << ANSI_DIM("Yes") << "\n"
+        << UTF_VERTICAL_LINE << "\n";
+  } else if (result == PromptResult::Declined) {
+    out << "\n"
+        << UTF_VERTICAL_LINE << "  " << ANSI_DIM("No") << "\n"
+        << UTF_VERTICAL_LINE << "\n"
+        << UTF_CORNER_BOTTOM_LEFT << ANSI_RED("  Exiting.")
+        << "\n\n";
+  } else {
+    // 显示取消状态
+    out << "\n"
+        << UTF_VERTICAL_LINE << "  "
+        << ANSI_CANCELLED((choice == Yes ? "Yes" : "No")) << "\n"
+        << UTF_VERTICAL_LINE << "\n"
+        << UTF_CORNER_BOTTOM_LEFT << ANSI_RED("  Exiting.") << "\n\n";
+  }
+}
+
+void CLI_PromptInput::begin(TermSession &term) {
+  // 粘贴内容中的换行不应直接提交输入
+  bracketed_paste = term.caps().bracketedPaste;
+  if (bracketed_paste)
+    term.out().write("\033[?2004h");
+
+  if (validator) {
+    // 校验结果在工作线程上产生，通过唤醒会话回到会话所在线程重绘
+    TermSession *session = &term;
+    checker = std::make_unique<AsyncValidator>(
+        validator, std::chrono::milliseconds(validate_debounce_ms),
+        [session] { session->wake(); });
+    // 重新打开时校验已有的输入
+    if (!input.empty() || !fallback.empty())
+      checker->submit(input.empty() ? fallback : input);
+  }
+}
+
+void CLI_PromptInput::prompt(TermFrame &out) const {
   std::string display = input;
   if (display.empty() && !fallback.empty()) {
     // 第一个字符反转模拟光标，其余字符淡化显示
@@ -122,507 +255,1176 @@ void CLI_PromptInput::prompt(TermCoord pos) const {
   }
   else
     display += "\033[7m \033[0m"; // Psuedo-cursor effect
-  std::cout << (warn_need_input ? ANSI_YELLOW(UTF_VERTICAL_LINE) : ANSI_BLUE(UTF_VERTICAL_LINE)) << "  " << display << "\033[K";
-
+  bool warn = warn_need_input || !validation_message.empty();
 
-  TermCoord top = pos;
-  top.Y -= 1;
-  moveCursorTo(top);
-  std::cout << (warn_need_input ? ANSI_YELLOW(UTF_TRIANGLE_UP)
+  out.moveTo(TermCoord{0, 0});
+  out << (warn ? ANSI_YELLOW(UTF_TRIANGLE_UP)
                   : ICON_PROMPT(state))
       << "  " << label << "\033[K";
 
-  moveCursorTo(addY(pos, 1));
-  if (warn_need_input) {
-    std::cout << ANSI_YELLOW(UTF_CORNER_BOTTOM_LEFT)
-        << ANSI_YELLOW("  Value cannot be empty.") << "\033[K";
+  out.moveTo(TermCoord{0, 1});
+  out << (warn ? ANSI_YELLOW(UTF_VERTICAL_LINE) : ANSI_BLUE(UTF_VERTICAL_LINE)) << "  " << display << "\033[K";
+
+  out.moveTo(TermCoord{0, 2});
+  if (warn) {
+    out << ANSI_YELLOW(UTF_CORNER_BOTTOM_LEFT)
+        << ANSI_YELLOW("  " + (warn_need_input ? std::string("Value cannot be empty.")
+                                               : validation_message))
+        << "\033[K";
   } else {
-    std::cout << ANSI_BLUE(UTF_CORNER_BOTTOM_LEFT) << "\033[K";
+    out << ANSI_BLUE(UTF_CORNER_BOTTOM_LEFT) << "\033[K";
   }
-  std::cout.flush();
 }
 
-bool CLI_PromptInput::run(bool isLastPrompt) {
-  std::cout << ICON_PROMPT(state) << "  " << label << "\n";
-  std::cout << UTF_VERTICAL_LINE << "\n";
+PromptResult CLI_PromptInput::handle(TermSession &, const KeyEvent &evt) {
+  warn_need_input = false;
+
+  switch (evt.key) {
+    case Key::Char:
+      if (evt.ch >= 32 && evt.ch <= 126) {
+        input.push_back(evt.ch);
+        enter_pending = false;
+        if (checker)
+          checker->submit(input);
+      }
+      break;
 
-  TermCoord inputLine = addY(getCursorPosition(), -1);  // 输入行位置
+    case Key::Backspace:
+      if (!input.empty()) {
+        input.pop_back();
+        enter_pending = false;
+        if (checker)
+          checker->submit(input.empty() ? fallback : input);
+      }
+      break;
 
-  while (true) {
-    prompt(inputLine);  // 显示模拟光标
-    warn_need_input = false;
-    KeyEvent evt = get_key_event();
+    case Key::PasteBegin:
+    case Key::PasteEnd:
+      pasting = evt.key == Key::PasteBegin;
+      break;
 
-    switch (evt.key) {
-      case Key::Char:
-        if (evt.ch >= 32 && evt.ch <= 126)
-          input.push_back(evt.ch);
+    case Key::Enter:
+      if (pasting)
         break;
-
-      case Key::Backspace:
-        if (!input.empty())
-          input.pop_back();
+      if (input.empty() && fallback.empty()) {
+        warn_need_input = true;
         break;
-
-      case Key::Enter: {
-        if (input.empty()) {
-          if (fallback.empty()) {
-            warn_need_input = true;
-            break;
-          }
-          input = fallback;
+      }
+      if (checker) {
+        // 校验未完成时不阻塞会话：跳过防抖，结果到达后在 tick() 中提交
+        if (!checker->ready()) {
+          checker->flush();
+          enter_pending = true;
+          break;
         }
-        state = PromptState::Succeed;
+        validation_message = checker->message();
+        if (!validation_message.empty())
+          break;
+      }
+      if (input.empty())
+        input = fallback;
+      state = PromptState::Succeed;
+      return PromptResult::Accepted;
 
-        clearLineAt(inputLine);
-        clearLineAt(addY(inputLine, 1));
+    case Key::Escape:
+    case Key::CtrlC:
+      state = PromptState::Failed;
+      return PromptResult::Cancelled;
 
-        moveCursorTo(addY(inputLine, -1));
-        std::cout << ICON_PROMPT(state) << "  " << label << "\033[K";
+    default:
+      break;
+  }
+  return PromptResult::Pending;
+}
 
-        std::cout << "\n" << UTF_VERTICAL_LINE << "  " << ANSI_DIM(input)
-            << "\n" << UTF_VERTICAL_LINE << "\n";
-        return true;
-      }
+PromptResult CLI_PromptInput::tick(TermSession &) {
+  if (!checker || !checker->ready())
+    return PromptResult::Pending;
+  validation_message = checker->message();
+  if (!enter_pending)
+    return PromptResult::Pending;
+
+  enter_pending = false;
+  if (!validation_message.empty())
+    return PromptResult::Pending;
+  if (input.empty())
+    input = fallback;
+  state = PromptState::Succeed;
+  return PromptResult::Accepted;
+}
 
-      case Key::Escape:
-      case Key::CtrlC: {
-        state = PromptState::Failed;
+void CLI_PromptInput::recall(const AnswerStore &store, const std::string &key) {
+  // 上次的输入成为默认值，直接 Enter 即可沿用
+  std::string last;
+  if (store.text(key, last) && !last.empty())
+    fallback = last;
+}
 
-        clearLineAt(inputLine);
-        clearLineAt(addY(inputLine, 1));
+void CLI_PromptInput::remember(AnswerStore &store, const std::string &key) const {
+  store.setText(key, input);
+}
 
-        moveCursorTo(addY(inputLine, -1));
-        std::cout << ICON_PROMPT(state) << "  " << label << "\033[K";
+void CLI_PromptInput::abandon(TermFrame &out) {
+  checker.reset();
+  enter_pending = false;
+  pasting = false;
+  if (bracketed_paste)
+    out << "\033[?2004l";
+}
 
-        if (!input.empty())
-          std::cout << "\n" << UTF_VERTICAL_LINE << "  " << ANSI_CANCELLED(input);
+void CLI_PromptInput::finish(TermFrame &out, PromptResult result) {
+  abandon(out);
 
-        std::cout << "\n" << UTF_VERTICAL_LINE << "\n"
-            << UTF_CORNER_BOTTOM_LEFT << ANSI_RED("  Operation cancelled.")
-            << "\n\n";
-        setCursorVisible(true);
-        exit(1);
-      }
+  out << ICON_PROMPT(state) << "  " << label;
+  if (result == PromptResult::Accepted) {
+    out << "\n" << UTF_VERTICAL_LINE << "  " << ANSI_DIM(input)
+        << "\n" << UTF_VERTICAL_LINE << "\n";
+  } else {
+    if (!input.empty())
+      out << "\n" << UTF_VERTICAL_LINE << "  " << ANSI_CANCELLED(input);
 
-      default:
-        break;
-    }
+    out << "\n" << UTF_VERTICAL_LINE << "\n"
+        << UTF_CORNER_BOTTOM_LEFT << ANSI_RED("  Operation cancelled.")
+        << "\n\n";
   }
 }
 
-void CLI_PromptBoolean::prompt(TermCoord pos) const {
-  moveCursorTo(pos);
+void CLI_PromptBoolean::prompt(TermFrame &out) const {
+  HIT_BOOLEAN(hits);
+  out.moveTo(TermCoord{0, 0});
+  out << ICON_PROMPT(state) << "  " << label << "\033[K";
 
-  std::cout << ANSI_BLUE(UTF_VERTICAL_LINE) << "  ";
-  std::cout << ICON_BOOLEAN(choice == Yes, "Yes") << ANSI_DIM(" / ")
+  out.moveTo(TermCoord{0, 1});
+  out << ANSI_BLUE(UTF_VERTICAL_LINE) << "  ";
+  out << ICON_BOOLEAN(choice == Yes, "Yes") << ANSI_DIM(" / ")
       << ICON_BOOLEAN(choice == No, "No");
-  std::cout << "\n" << ANSI_BLUE(UTF_CORNER_BOTTOM_LEFT);
+  out << "\033[K\n" << ANSI_BLUE(UTF_CORNER_BOTTOM_LEFT);
 
-  std::cout << "\033[K";
-  std::cout.flush();
+  out << "\033[K";
 }
 
-bool CLI_PromptBoolean::run(bool isLastPrompt) {
-  std::cout << ICON_PROMPT(state) << "  " << label << "\n";
-  std::cout << UTF_VERTICAL_LINE << "\n";
+PromptResult CLI_PromptBoolean::handle(TermSession &, const KeyEvent &evt) {
+  switch (evt.key) {
+    case Key::ArrowLeft:
+    case Key::ArrowUp:
+      choice = Yes;
+      break;
+    case Key::ArrowRight:
+    case Key::ArrowDown:
+      choice = No;
+      break;
 
-  TermCoord pos = getCursorPosition();
-  pos.Y -= 1;
+    case Key::Enter:
+      state = PromptState::Succeed;
+      return PromptResult::Accepted;
 
-  while (true) {
-    prompt(pos);
-    KeyEvent evt = get_key_event();
+    case Key::CtrlC:
+      state = PromptState::Failed;
+      return PromptResult::Cancelled;
 
-    switch (evt.key) {
-      case Key::ArrowLeft:
-      case Key::ArrowUp:
-        choice = Yes;
-        break;
-      case Key::ArrowRight:
-      case Key::ArrowDown:
-        choice = No;
-        break;
+    default:
+      break;
+  }
+  return PromptResult::Pending;
+}
+
+PromptResult CLI_PromptBoolean::handleMouse(TermSession &, const KeyEvent &evt,
+                                            bool &changed) {
+  int highlight = choice;
+  int clicked = track_click(hits, pressed, highlight, evt, changed);
+  choice = static_cast<BooleanChoice>(highlight);
+  if (clicked == HitMap::none)
+    return PromptResult::Pending;
+  state = PromptState::Succeed;
+  return PromptResult::Accepted;
+}
 
-      case Key::Enter: {
-        state = PromptState::Succeed;
+void CLI_PromptBoolean::recall(const AnswerStore &store, const std::string &key) {
+  std::string last;
+  if (store.text(key, last))
+    choice = last == "No" ? No : Yes;
+}
 
-        // 清除选择和底线行
-        clearLineAt(pos);
-        TermCoord below = pos;
-        below.Y += 1;
-        clearLineAt(below);
+void CLI_PromptBoolean::remember(AnswerStore &store, const std::string &key) const {
+  store.setText(key, choice == Yes ? "Yes" : "No");
+}
 
-        // 重绘首行图标
-        TermCoord top = pos;
-        top.Y -= 1;
-        moveCursorTo(top);
-        std::cout << ICON_PROMPT(state) << "  " << label << "\033[K";
+void CLI_PromptBoolean::finish(TermFrame &out, PromptResult result) {
+  out << ICON_PROMPT(state) << "  " << label;
 
-        // 显示最终选择
-        std::cout << "\n"
-            << UTF_VERTICAL_LINE << "  "
-            << ANSI_DIM((choice == Yes ? "Yes" : "No")) << "\n"
-            << UTF_VERTICAL_LINE << "\n";
+  if (result == PromptResult::Accepted) {
+    // 显示最终选择
+    out << "\n"
+        << UTF_VERTICAL_LINE << "  "
+        << ANSI_DIM((choice == Yes ? "Yes" : "No")) << "\n"
+        << UTF_VERTICAL_LINE << "\n";
+  } else {
+    // 显示取消状态
+    out << "\n"
+        << UTF_VERTICAL_LINE << "  "
+        << ANSI_CANCELLED((choice == Yes ? "Yes" : "No")) << "\n"
+        << UTF_VERTICAL_LINE << "\n"
+        << UTF_CORNER_BOTTOM_LEFT
+        << ANSI_RED("  Operation cancelled..") << "\n\n";
+  }
+}
 
-        return true;
-      }
 
-      case Key::CtrlC: {
-        state = PromptState::Failed;
-
-        // 清除选择和底线行
-        clearLineAt(pos);
-        TermCoord below = pos;
-        below.Y += 1;
-        clearLineAt(below);
-
-        // 重绘首行图标
-        TermCoord top = pos;
-        top.Y -= 1;
-        moveCursorTo(top);
-        std::cout << ICON_PROMPT(state) << "  " << label << "\033[K";
-
-        // 显示取消状态
-        std::cout << "\n"
-            << UTF_VERTICAL_LINE << "  "
-            << ANSI_CANCELLED((choice == Yes ? "Yes" : "No")) << "\n"
-            << UTF_VERTICAL_LINE << "\n"
-            << UTF_CORNER_BOTTOM_LEFT
-            << ANSI_RED("  Operation cancelled..") << "\n\n";
-        setCursorVisible(true);
-        exit(1);
-      }
 
-      default:
-        break;
-    }
-  }
+
+
+void CLI_PromptSingleSelect::begin(TermSession &) {
+  // 选项可能在两次打开之间被修改（如按记忆重排）
+  described = has_description(options);
+  wrapped.clear();
 }
 
+int CLI_PromptSingleSelect::visibleRows() const {
+  return std::min(static_cast<int>(options.size()), std::max(pageRows, 1));
+}
 
+void CLI_PromptSingleSelect::scrollTo(int index) {
+  selectedIndex = index;
+  keep_visible(top, index, visibleRows());
+}
 
+void CLI_PromptSingleSelect::prompt(TermFrame &out) const {
+  const int page = visibleRows();
+  const size_t optionWidth = static_cast<size_t>(std::max(out.width() - 6, 1));
+  hits.reset(rows());
 
+  out.moveTo(TermCoord{0, 0});
+  out << ICON_PROMPT(state) << "  " << label << "\033[K";
 
-void CLI_PromptSingleSelect::prompt(TermCoord pos) const {
-  for (size_t i = 0; i < options.size(); ++i) {
-    TermCoord line = pos;
-    line.Y += static_cast<int>(i);
-    moveCursorTo(line);
+  for (int row = 0; row < page; ++row) {
+    const size_t i = static_cast<size_t>(top + row);
+    out.moveTo(TermCoord{0, static_cast<decltype(TermCoord::Y)>(row + 1)});
+    hits.add(row + 1, static_cast<int>(i));
 
-    std::cout << ANSI_BLUE(UTF_VERTICAL_LINE) << "  ";
+    out << ANSI_BLUE(UTF_VERTICAL_LINE) << "  ";
 
+    // 选项过长时截断，避免终端折行打乱行号
+    const std::string option = clip_width(options[i].option, optionWidth);
     if (i == static_cast<size_t>(selectedIndex)) {
-      std::cout << ANSI_GREEN(UTF_RADIO_FILLED) << " " << options[i].option
-          << " " << ANSI_DIM(options[i].description);
+      out << ANSI_GREEN(UTF_RADIO_FILLED) << " " << option;
     } else {
-      std::cout << ANSI_DIM(
-        (std::string(UTF_RADIO_EMPTY) + " " + options[i].option));
+      out << ANSI_DIM((std::string(UTF_RADIO_EMPTY) + " " + option));
     }
 
-    std::cout << "\033[K"; // 清除剩余行尾
+    out << "\033[K"; // 清除剩余行尾
+  }
+
+  if (panelRows() > 0)
+    DESCRIPTION_PANEL(out, page + 1, panelRows(), ANSI_BLUE(UTF_VERTICAL_LINE), wrapped,
+                      selectedIndex, options[selectedIndex].description);
+
+  out.moveTo(TermCoord{0, static_cast<decltype(TermCoord::Y)>(page + panelRows() + 1)});
+  out << ANSI_BLUE(UTF_CORNER_BOTTOM_LEFT) << VIEW_RANGE(top, page, options.size())
+      << "\033[K";
+}
+
+PromptResult CLI_PromptSingleSelect::handle(TermSession &, const KeyEvent &evt) {
+  switch (evt.key) {
+    case Key::ArrowLeft:
+    case Key::ArrowUp:
+      if (selectedIndex > 0)
+        scrollTo(selectedIndex - 1);
+      else
+        scrollTo(static_cast<int>(options.size()) - 1);
+      break;
+
+    case Key::ArrowRight:
+    case Key::ArrowDown:
+      if (selectedIndex < static_cast<int>(options.size()) - 1)
+        scrollTo(selectedIndex + 1);
+      else
+        scrollTo(0);
+      break;
+
+    case Key::Enter:
+      state = PromptState::Succeed;
+      return PromptResult::Accepted;
+
+    case Key::CtrlC:
+      state = PromptState::Failed;
+      return PromptResult::Cancelled;
+
+    default:
+      break;
   }
+  return PromptResult::Pending;
+}
 
-  TermCoord bottom = pos;
-  bottom.Y += static_cast<int>(options.size());
-  moveCursorTo(bottom);
-  std::cout << ANSI_BLUE(UTF_CORNER_BOTTOM_LEFT) << "\033[K";
-  std::cout.flush();
+PromptResult CLI_PromptSingleSelect::handleMouse(TermSession &, const KeyEvent &evt,
+                                                 bool &changed) {
+  if (evt.key == Key::WheelUp || evt.key == Key::WheelDown) {
+    changed = scroll_wheel(top, selectedIndex, static_cast<int>(options.size()),
+                           visibleRows(), evt);
+    return PromptResult::Pending;
+  }
+  if (track_click(hits, pressed, selectedIndex, evt, changed) == HitMap::none)
+    return PromptResult::Pending;
+  state = PromptState::Succeed;
+  return PromptResult::Accepted;
+}
+
+Answer CLI_PromptSingleSelect::answer() const {
+  if (options.empty())
+    return std::monostate();
+  return options[selectedIndex].option;
+}
+
+void CLI_PromptSingleSelect::recall(const AnswerStore &store, const std::string &key) {
+  std::vector<char> none;
+  std::vector<AnswerStore::Usage> usage = rank_options(store, key, rank, options, none);
+  // 预选上次选中的项
+  for (size_t i = 0; i < usage.size(); ++i)
+    if (usage[i].chosen)
+      selectedIndex = static_cast<int>(i);
+  top = 0;
+  scrollTo(selectedIndex);
 }
 
-bool CLI_PromptSingleSelect::run(bool isLastPrompt) {
-  std::cout << ICON_PROMPT(state) << "  " << label << "\n";
+void CLI_PromptSingleSelect::remember(AnswerStore &store, const std::string &key) const {
   for (size_t i = 0; i < options.size(); ++i)
-    std::cout << UTF_VERTICAL_LINE << "\n";
+    store.choose(key, options[i].option, static_cast<int>(i) == selectedIndex);
+}
+
+void CLI_PromptSingleSelect::finish(TermFrame &out, PromptResult result) {
+  out << ICON_PROMPT(state) << "  " << label << "\n";
+
+  if (result == PromptResult::Accepted) {
+    // 输出选中的项
+    out << UTF_VERTICAL_LINE << "  "
+        << ANSI_DIM(options[selectedIndex].option) << "\n";
+    out << UTF_VERTICAL_LINE << "\n";
+  } else {
+    // 输出取消提示
+    out << UTF_VERTICAL_LINE << "  "
+        << ANSI_CANCELLED(options[selectedIndex].option) << "\n";
+    out << UTF_VERTICAL_LINE << "\n"
+        << UTF_CORNER_BOTTOM_LEFT
+        << ANSI_RED("  Operation cancelled.") << "\n\n";
+  }
+}
 
-  TermCoord pos = getCursorPosition();
-  pos.Y -= static_cast<int>(options.size());
 
-  while (true) {
-    prompt(pos);
 
-    KeyEvent evt = get_key_event();
-    switch (evt.key) {
-      case Key::ArrowLeft:
-      case Key::ArrowUp:
-        if (selectedIndex > 0)
-          selectedIndex--;
-        else
-          selectedIndex = static_cast<int>(options.size()) - 1;
-        break;
+void CLI_PromptMultiSelect::begin(TermSession &) {
+  described = has_description(options);
+  wrapped.clear();
+  // 选项可能在构造后才加入
+  selected.resize(options.size());
+  filtering = false;
+}
 
-      case Key::ArrowRight:
-      case Key::ArrowDown:
-        if (selectedIndex < static_cast<int>(options.size()) - 1)
-          selectedIndex++;
-        else
-          selectedIndex = 0;
-        break;
+int CLI_PromptMultiSelect::visibleRows() const {
+  return std::min(static_cast<int>(options.size()), std::max(pageRows, 1));
+}
 
-      case Key::Enter: {
-        state = PromptState::Succeed;
+void CLI_PromptMultiSelect::scrollTo(int index) {
+  selectedIndex = index;
+  keep_visible(top, index, visibleRows());
+}
 
-        // 清除所有选项行
-        for (size_t i = 0; i < options.size(); ++i) {
-          TermCoord line = pos;
-          line.Y += static_cast<int>(i);
-          clearLineAt(line);
-        }
+void CLI_PromptMultiSelect::moveTo(int index, bool shift) {
+  index = std::max(0, std::min(index, static_cast<int>(options.size()) - 1));
+  if (shift && anchor < static_cast<int>(options.size())) {
+    const int lo = std::min(anchor, index), hi = std::max(anchor, index);
+    selected.assign(lo, hi + 1, selected[anchor]);
+  }
+  scrollTo(index);
+}
 
-        // 重绘 header
-        TermCoord top = pos;
-        top.Y -= 1;
-        moveCursorTo(top);
-        std::cout << ICON_PROMPT(state) << "  " << label << "\033[K";
-
-        // 输出选中的项
-        moveCursorTo(pos);
-        std::cout << UTF_VERTICAL_LINE << "  "
-            << ANSI_DIM(options[selectedIndex].option) << "\n";
-        std::cout << UTF_VERTICAL_LINE << "\n";
-        return true;
-      }
+void CLI_PromptMultiSelect::toggle(int index) {
+  selected.flip(index);
+  anchor = index;
+}
 
-      case Key::CtrlC: {
-        state = PromptState::Failed;
+// ASCII 小写；过滤不区分大小写
+static char lower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
 
-        // 清除所有选项行
-        for (size_t i = 0; i < options.size(); ++i) {
-          TermCoord line = pos;
-          line.Y += static_cast<int>(i);
-          clearLineAt(line);
-        }
+static bool contains_folded(const std::string &text, const std::string &folded) {
+  auto it = std::search(text.begin(), text.end(), folded.begin(), folded.end(),
+                        [](char a, char b) { return lower(a) == b; });
+  return it != text.end();
+}
+
+void CLI_PromptMultiSelect::updateFilter(bool narrowed) {
+  if (!narrowed || matches.size() != options.size()) {
+    matches = BitSet(options.size(), true);
+    if (filter.empty())
+      return;
+  }
+  // 变长的过滤词只会减少匹配，只复查仍匹配的项
+  matches.forEach([&](size_t i) {
+    if (!contains_folded(options[i].option, filter))
+      matches.set(i, false);
+  });
+  // 高亮项跟随到当前位置起的第一个匹配
+  size_t hit = matches.next(static_cast<size_t>(selectedIndex));
+  if (hit == matches.size())
+    hit = matches.next(0);
+  if (hit < matches.size())
+    scrollTo(static_cast<int>(hit));
+}
 
-        // 重绘 header
-        TermCoord top = pos;
-        top.Y -= 1;
-        moveCursorTo(top);
-        std::cout << ICON_PROMPT(state) << "  " << label << "\033[K";
-
-        // 清除底部装饰线
-        TermCoord bottom = pos;
-        bottom.Y += static_cast<int>(options.size());
-        clearLineAt(bottom);
-
-        // 输出取消提示
-        moveCursorTo(pos);
-        std::cout << UTF_VERTICAL_LINE << "  "
-            << ANSI_CANCELLED(options[selectedIndex].option) << "\n";
-        std::cout << UTF_VERTICAL_LINE << "\n"
-            << UTF_CORNER_BOTTOM_LEFT
-            << ANSI_RED("  Operation cancelled.") << "\n\n";
-        setCursorVisible(true);
-        exit(1);
+PromptResult CLI_PromptMultiSelect::handleFilter(const KeyEvent &evt) {
+  switch (evt.key) {
+    case Key::Char:
+      if (static_cast<unsigned char>(evt.ch) >= 0x20) {
+        filter += lower(evt.ch);
+        updateFilter(true);
       }
+      break;
 
-      default:
-        break;
-    }
+    case Key::Backspace:
+      if (!filter.empty()) {
+        filter.pop_back();
+        updateFilter(false);
+      }
+      break;
+
+    case Key::Enter:
+      // 空过滤词不做任何选择
+      if (!filter.empty())
+        selected |= matches;
+      filtering = false;
+      break;
+
+    case Key::Escape:
+      filtering = false;
+      break;
+
+    case Key::CtrlC:
+      state = PromptState::Failed;
+      return PromptResult::Cancelled;
+
+    default:
+      break;
   }
+  return PromptResult::Pending;
 }
 
+void CLI_PromptMultiSelect::prompt(TermFrame &out) const {
+  const int page = visibleRows();
+  const size_t optionWidth = static_cast<size_t>(std::max(out.width() - 6, 1));
+  const std::string bar = warn_no_selection ? ANSI_YELLOW(UTF_VERTICAL_LINE)
+                                            : ANSI_BLUE(UTF_VERTICAL_LINE);
+  hits.reset(rows());
 
+  out.moveTo(TermCoord{0, 0});
+  out << (warn_no_selection ? ANSI_YELLOW(UTF_TRIANGLE_UP)
+                  : ICON_PROMPT(state))
+      << "  " << label << "\033[K";
 
-void CLI_PromptMultiSelect::prompt(TermCoord pos) const {
-  for (size_t i = 0; i < options.size(); ++i) {
-    TermCoord line = pos;
-    line.Y += static_cast<int>(i);
-    moveCursorTo(line);
+  for (int row = 0; row < page; ++row) {
+    const size_t i = static_cast<size_t>(top + row);
+    out.moveTo(TermCoord{0, static_cast<decltype(TermCoord::Y)>(row + 1)});
+    hits.add(row + 1, static_cast<int>(i));
 
-    std::cout << (warn_no_selection ? ANSI_YELLOW(UTF_VERTICAL_LINE)
-                    : ANSI_BLUE(UTF_VERTICAL_LINE))
-        << "  ";
+    out << bar << "  ";
 
+    const std::string option = clip_width(options[i].option, optionWidth);
     if (i == static_cast<size_t>(selectedIndex)) {
-      std::cout << ICON_CHECKBOX(selected[i]) << " " << options[i].option;
+      out << ICON_CHECKBOX(selected[i]) << " " << option;
     } else {
-      std::cout << ICON_CHECKBOX(selected[i]) << " "
-          << ANSI_DIM(options[i].option);
+      out << ICON_CHECKBOX(selected[i]) << " " << ANSI_DIM(option);
     }
 
-    if (selected[i])
-      std::cout << " " << ANSI_DIM(options[i].description);
-
-    std::cout << "\033[K"; // 清除行尾
+    out << "\033[K"; // 清除行尾
   }
 
-  TermCoord top = pos;
-  top.Y -= 1;
-  moveCursorTo(top);
-  std::cout << (warn_no_selection ? ANSI_YELLOW(UTF_TRIANGLE_UP)
-                  : ICON_PROMPT(state))
-      << "  " << label << "\033[K";
+  if (panelRows() > 0)
+    DESCRIPTION_PANEL(out, page + 1, panelRows(), bar, wrapped, selectedIndex,
+                      options[selectedIndex].description);
 
-  TermCoord bottom = pos;
-  bottom.Y += static_cast<int>(options.size());
-  moveCursorTo(bottom);
-  if (warn_no_selection)
-    std::cout << ANSI_YELLOW(UTF_CORNER_BOTTOM_LEFT)
+  out.moveTo(TermCoord{0, static_cast<decltype(TermCoord::Y)>(page + panelRows() + 1)});
+  if (warn_no_selection) {
+    out << ANSI_YELLOW(UTF_CORNER_BOTTOM_LEFT)
         << ANSI_YELLOW("  Please select at least one option.")
         << "\033[K";
-  else
-    std::cout << ANSI_BLUE(UTF_CORNER_BOTTOM_LEFT) << "\033[K";
-  std::cout.flush();
+  } else if (filtering) {
+    out << ANSI_BLUE(UTF_CORNER_BOTTOM_LEFT) << "  /" << filter
+        << ANSI_DIM("  " + std::to_string(filter.empty() ? 0 : matches.count()) +
+                    " matching · Enter select · Esc cancel")
+        << "\033[K";
+  } else {
+    // 长列表中选中项多半不在视口内，显示总数
+    std::string range = VIEW_RANGE(top, page, options.size());
+    if (!range.empty() && selected.any())
+      range += ANSI_DIM(" · " + std::to_string(selected.count()) + " selected");
+    out << ANSI_BLUE(UTF_CORNER_BOTTOM_LEFT) << range << "\033[K";
+  }
 }
 
-bool CLI_PromptMultiSelect::run(bool isLastPrompt) {
-  std::cout << ICON_PROMPT(state) << "  " << label << "\n";
-  for (size_t i = 0; i < options.size(); ++i)
-    std::cout << UTF_VERTICAL_LINE << "\n";
+PromptResult CLI_PromptMultiSelect::handle(TermSession &, const KeyEvent &evt) {
+  warn_no_selection = false;
+  if (filtering)
+    return handleFilter(evt);
+
+  const int last = static_cast<int>(options.size()) - 1;
+  switch (evt.key) {
+    case Key::ArrowLeft:
+    case Key::ArrowUp:
+      // 扩展范围时不回绕
+      if (evt.shift)
+        moveTo(selectedIndex - 1, true);
+      else
+        scrollTo(selectedIndex > 0 ? selectedIndex - 1 : last);
+      break;
 
-  TermCoord pos = getCursorPosition();
-  pos.Y -= static_cast<int>(options.size());
+    case Key::ArrowRight:
+    case Key::ArrowDown:
+      if (evt.shift)
+        moveTo(selectedIndex + 1, true);
+      else
+        scrollTo(selectedIndex < last ? selectedIndex + 1 : 0);
+      break;
 
-  while (true) {
-    prompt(pos);
+    case Key::PageUp:
+      moveTo(selectedIndex - visibleRows(), evt.shift);
+      break;
 
-    KeyEvent evt = get_key_event();
-    warn_no_selection = false;
-    switch (evt.key) {
-      case Key::ArrowLeft:
-      case Key::ArrowUp:
-        if (selectedIndex > 0)
-          selectedIndex--;
-        else
-          selectedIndex = static_cast<int>(options.size()) - 1;
-        break;
+    case Key::PageDown:
+      moveTo(selectedIndex + visibleRows(), evt.shift);
+      break;
 
-      case Key::ArrowRight:
-      case Key::ArrowDown:
-        if (selectedIndex < static_cast<int>(options.size()) - 1)
-          selectedIndex++;
-        else
-          selectedIndex = 0;
+    case Key::Home:
+      moveTo(0, evt.shift);
+      break;
+
+    case Key::End:
+      moveTo(last, evt.shift);
+      break;
+
+    case Key::Char:
+      switch (evt.ch) {
+        case ' ': toggle(selectedIndex); break;
+        case 'a': selected.fill(true); break;
+        case 'n': selected.fill(false); break;
+        case 'i': selected.invert(); break;
+        case '/':
+          filtering = true;
+          filter.clear();
+          updateFilter(false);
+          break;
+        default: break;
+      }
+      break;
+
+    case Key::Enter:
+      if (!nullable && !selected.any()) {
+        warn_no_selection = true;
         break;
+      }
+      state = PromptState::Succeed;
+      return PromptResult::Accepted;
 
-      case Key::Char:
-        if (evt.ch == ' ') {
-          selected[selectedIndex] = !selected[selectedIndex];
-          selectedCount += selected[selectedIndex] ? 1 : -1;
-        }
+    case Key::CtrlC:
+      state = PromptState::Failed;
+      return PromptResult::Cancelled;
+
+    default:
+      break;
+  }
+  return PromptResult::Pending;
+}
+
+PromptResult CLI_PromptMultiSelect::handleMouse(TermSession &, const KeyEvent &evt,
+                                                bool &changed) {
+  if (evt.key == Key::WheelUp || evt.key == Key::WheelDown) {
+    changed = scroll_wheel(top, selectedIndex, static_cast<int>(options.size()),
+                           visibleRows(), evt);
+    return PromptResult::Pending;
+  }
+  // 点击切换该项，与空格键相同
+  int clicked = track_click(hits, pressed, selectedIndex, evt, changed);
+  if (clicked != HitMap::none) {
+    // Shift 点击与 Shift 方向键相同，扩展范围
+    if (evt.shift)
+      moveTo(clicked, true);
+    else
+      toggle(clicked);
+    changed = true;
+  }
+  if (changed)
+    warn_no_selection = false;
+  return PromptResult::Pending;
+}
+
+Answer CLI_PromptMultiSelect::answer() const {
+  std::vector<std::string> chosen;
+  for (size_t i = 0; i < options.size(); ++i)
+    if (selected[i])
+      chosen.push_back(options[i].option);
+  return chosen;
+}
+
+void CLI_PromptMultiSelect::recall(const AnswerStore &store, const std::string &key) {
+  selected.resize(options.size());
+  std::vector<bool> keep(options.size());
+  for (size_t i = 0; i < options.size(); ++i)
+    keep[i] = selected[i];
+  std::vector<AnswerStore::Usage> usage = rank_options(store, key, rank, options, keep);
+  // 预选上次选中的项
+  for (size_t i = 0; i < options.size(); ++i)
+    selected.set(i, keep[i] || usage[i].chosen);
+}
+
+void CLI_PromptMultiSelect::remember(AnswerStore &store, const std::string &key) const {
+  for (size_t i = 0; i < options.size(); ++i)
+    store.choose(key, options[i].option, selected[i]);
+}
+
+void CLI_PromptMultiSelect::finish(TermFrame &out, PromptResult result) {
+  out << ICON_PROMPT(state) << "  " << label << "\n";
+  out << UTF_VERTICAL_LINE << "  ";
+
+  const bool accepted = result == PromptResult::Accepted;
+  const size_t total = selected.count();
+  // 记录只占一行：放不下的选中项以 “+N more” 概括，避免终端折行
+  const size_t width = static_cast<size_t>(std::max(out.width() - 4, 1));
+  const size_t reserve = 16; // ", +NNNNNN more"
+  size_t used = 0, shown = 0;
+  for (size_t i = selected.next(0); i < options.size(); i = selected.next(i + 1)) {
+    const bool last = shown + 1 == total;
+    std::string name = options[i].option;
+    if (shown == 0)
+      name = clip_width(name, width > reserve ? width - reserve : 1);
+    const size_t need = display_width(name) + (shown ? 2 : 0);
+    if (shown && used + need + (last ? 0 : reserve) > width)
+      break;
+    const std::string sep = shown ? ", " : "";
+    if (accepted)
+      out << ANSI_DIM(sep + name);
+    else
+      out << (shown ? ANSI_DIM(sep + ANSI_STRIKETHROUGH(name))
+                    : ANSI_STRIKETHROUGH(ANSI_DIM(name)));
+    used += need;
+    ++shown;
+  }
+  if (shown < total)
+    out << ANSI_DIM(", +" + std::to_string(total - shown) + " more");
+
+  if (accepted) {
+    // 输出已选项
+    if (total == 0)
+      out << ANSI_DIM("none");
+
+    out << "\n"
+        << UTF_VERTICAL_LINE << "\n"
+        << UTF_VERTICAL_LINE << "\n";
+  } else {
+    bool noSelected = total == 0;
+
+    out << "\n" << (noSelected ? "": (std::string(UTF_VERTICAL_LINE) + "\n"))
+        << UTF_CORNER_BOTTOM_LEFT
+        << ANSI_RED("  Operation cancelled.") << "\n\n";
+  }
+}
+
+int CLI_PromptTable::visibleRows() const {
+  size_t rows = std::min<size_t>(std::max(pageRows, 1), rowCount);
+  return rows ? static_cast<int>(rows) : 1;
+}
+
+void CLI_PromptTable::measure(size_t row, size_t column) const {
+  if (columns[column].width > 0 || widths[column] >= maxColumnWidth)
+    return;
+  int w = static_cast<int>(display_width(cell(row, column)));
+  widths[column] = std::max(widths[column], std::min(w, maxColumnWidth));
+}
+
+void CLI_PromptTable::measureVisible() const {
+  if (widths.size() != columns.size())
+    return;
+  const size_t page = static_cast<size_t>(visibleRows());
+  // 与 renderRow() 相同的取列规则
+  int avail = viewWidth - 5;
+  for (size_t c = firstColumn; c < columns.size() && avail > 0; ++c) {
+    if (c > firstColumn) {
+      if (avail < 6)
         break;
+      avail -= 2;
+    }
+    if (!sampled[c]) {
+      // 列首次可见时均匀抽取 widthSample 行估计宽度
+      sampled[c] = true;
+      size_t samples = std::min(rowCount, widthSample);
+      for (size_t i = 0; i < samples; ++i)
+        measure(i * (rowCount / samples), c);
+    }
+    for (size_t p = top; p < std::min(top + page, rowCount); ++p)
+      measure(rowAt(p), c);
+    avail -= widths[c];
+  }
+}
 
-      case Key::Enter: {
-        if (!nullable && selectedCount <= 0) {
-          warn_no_selection = true;
-          break;
-        }
+void CLI_PromptTable::begin(TermSession &term) {
+  viewWidth = term.width();
+
+  // 标题宽度另留出排序箭头的位置
+  widths.assign(columns.size(), 0);
+  for (size_t c = 0; c < columns.size(); ++c)
+    widths[c] = columns[c].width > 0
+                    ? columns[c].width
+                    : static_cast<int>(display_width(columns[c].title)) + 2;
+  sampled.assign(columns.size(), false);
+  scrollTo(std::min(selectedIndex, rowCount ? rowCount - 1 : 0));
+}
 
-        state = PromptState::Succeed;
+void CLI_PromptTable::scrollTo(size_t pos) {
+  const size_t page = static_cast<size_t>(visibleRows());
+  selectedIndex = pos;
+  if (pos < top)
+    top = pos;
+  else if (pos >= top + page)
+    top = pos - page + 1;
+  measureVisible();
+}
 
-        // 清除所有选项行
-        for (size_t i = 0; i < options.size(); ++i) {
-          TermCoord line = pos;
-          line.Y += static_cast<int>(i);
-          clearLineAt(line);
-        }
+void CLI_PromptTable::sortBy(int column, bool descending) {
+  if (column < 0 || static_cast<size_t>(column) >= columns.size())
+    return;
+  if (column == sortColumn && descending == sortDescending)
+    return;
+  const size_t current = selectedRow();
+
+  // 同一列换方向：反转即可，不必重新取键排序（相等的行顺序随之反转）
+  if (column == sortColumn && !order.empty()) {
+    std::reverse(order.begin(), order.end());
+    sortDescending = descending;
+    if (rowCount)
+      scrollTo(rowCount - 1 - selectedIndex);
+    return;
+  }
+  sortColumn = column;
+  sortDescending = descending;
 
-        // 清除底部提示符行
-        TermCoord bottom = pos;
-        bottom.Y += static_cast<int>(options.size());
-        clearLineAt(bottom);
-
-        // 重绘 header
-        TermCoord top = pos;
-        top.Y -= 1;
-        moveCursorTo(top);
-        std::cout << ICON_PROMPT(state) << "  " << label << "\033[K";
-
-        // 输出已选项
-        moveCursorTo(pos);
-        std::cout << UTF_VERTICAL_LINE << "  ";
-        size_t i = 0;
-        while (i < options.size() && !selected[i])
-          i++;
-
-        if (i < options.size())
-          std::cout << ANSI_DIM(options[i].option);
-        else
-          std::cout << ANSI_DIM("none");
+  if (order.empty()) {
+    order.resize(rowCount);
+    std::iota(order.begin(), order.end(), size_t(0));
+  }
 
-        for (; ++i < options.size();)
-          if (selected[i])
-            std::cout << ANSI_DIM(", " + options[i].option);
+  // 只对行号排序；每行的键只取一次。排序后用同一比较二分找回选中行，
+  // 只需在键相等的一段里逐个比对
+  auto sortOn = [&](const auto &less) {
+    auto cmp = [&](size_t a, size_t b) { return descending ? less(b, a) : less(a, b); };
+    std::stable_sort(order.begin(), order.end(), cmp);
+    if (current == npos)
+      return;
+    auto range = std::equal_range(order.begin(), order.end(), current, cmp);
+    auto it = std::find(range.first, range.second, current);
+    scrollTo(static_cast<size_t>(it - order.begin()));
+  };
+  const TableColumn &col = columns[column];
+  if (col.less) {
+    sortOn(col.less);
+  } else if (col.numeric) {
+    std::vector<double> keys(rowCount);
+    for (size_t r = 0; r < rowCount; ++r)
+      keys[r] = std::strtod(cell(r, column).c_str(), nullptr);
+    sortOn([&](size_t a, size_t b) { return keys[a] < keys[b]; });
+  } else {
+    std::vector<std::string> keys(rowCount);
+    for (size_t r = 0; r < rowCount; ++r)
+      keys[r] = cell(r, column);
+    sortOn([&](size_t a, size_t b) { return keys[a] < keys[b]; });
+  }
+}
 
-        std::cout << "\n"
-            << UTF_VERTICAL_LINE << "\n"
-            << UTF_VERTICAL_LINE << "\n";
-        return true;
-      }
+std::string CLI_PromptTable::renderRow(size_t row, bool header) const {
+  // 只渲染从 firstColumn 起放得下的列
+  int avail = viewWidth - 5; // "│  › "
+  std::string line;
+  for (size_t c = firstColumn; c < columns.size() && avail > 0; ++c) {
+    if (c > firstColumn) {
+      if (avail < 6)
+        break;
+      line += "  ";
+      avail -= 2;
+    }
+    std::string text = header ? columns[c].title : cell(row, c);
+    if (header && static_cast<int>(c) == sortColumn)
+      text += std::string(" ") + (sortDescending ? UTF_TRIANGLE_DOWN : UTF_TRIANGLE_UP);
+    int w = std::min(widths[c], avail);
+    line += fit_width(text, static_cast<size_t>(w), columns[c].numeric);
+    avail -= w;
+  }
+  return line;
+}
 
-      case Key::CtrlC: {
-        state = PromptState::Failed;
+void CLI_PromptTable::prompt(TermFrame &out) const {
+  // 终端宽度变化后可能露出新的列
+  if (out.width() != viewWidth) {
+    viewWidth = out.width();
+    measureVisible();
+  }
 
-        // 清除所有选项行
-        for (size_t i = 0; i < options.size(); ++i) {
-          TermCoord line = pos;
-          line.Y += static_cast<int>(i);
-          clearLineAt(line);
-        }
+  out.moveTo(TermCoord{0, 0});
+  out << ICON_PROMPT(state) << "  " << label
+      << ANSI_DIM("  " + std::to_string(rowCount ? selectedIndex + 1 : 0) +
+                  "/" + std::to_string(rowCount))
+      << "\033[K";
+
+  out.moveTo(TermCoord{0, 1});
+  out << ANSI_BLUE(UTF_VERTICAL_LINE) << "    " << ANSI_DIM(renderRow(0, true))
+      << "\033[K";
+
+  const int page = visibleRows();
+  for (int i = 0; i < page; ++i) {
+    out.moveTo(TermCoord{0, static_cast<decltype(TermCoord::Y)>(i + 2)});
+    out << ANSI_BLUE(UTF_VERTICAL_LINE);
+
+    size_t pos = top + static_cast<size_t>(i);
+    if (pos >= rowCount) {
+      if (rowCount == 0)
+        out << "    " << ANSI_DIM("(no rows)");
+    } else if (pos == selectedIndex) {
+      out << "  " << ANSI_GREEN(UTF_POINTER) << " "
+          << renderRow(rowAt(pos), false);
+    } else {
+      out << "    " << ANSI_DIM(renderRow(rowAt(pos), false));
+    }
+    out << "\033[K";
+  }
+
+  out.moveTo(TermCoord{0, static_cast<decltype(TermCoord::Y)>(page + 2)});
+  out << ANSI_BLUE(UTF_CORNER_BOTTOM_LEFT)
+      << ANSI_DIM(u8"  ↑↓ move · PgUp/PgDn page · "
+                  u8"←→ columns · 1-9 sort")
+      << "\033[K";
+}
+
+PromptResult CLI_PromptTable::handle(TermSession &, const KeyEvent &evt) {
+  const size_t page = static_cast<size_t>(visibleRows());
+  const size_t last = rowCount ? rowCount - 1 : 0;
+
+  switch (evt.key) {
+    case Key::ArrowUp:
+      if (selectedIndex > 0)
+        scrollTo(selectedIndex - 1);
+      break;
+    case Key::ArrowDown:
+      if (selectedIndex < last)
+        scrollTo(selectedIndex + 1);
+      break;
+    case Key::PageUp:
+      scrollTo(selectedIndex > page ? selectedIndex - page : 0);
+      break;
+    case Key::PageDown:
+      scrollTo(std::min(selectedIndex + page, last));
+      break;
+    case Key::Home:
+      scrollTo(0);
+      break;
+    case Key::End:
+      scrollTo(last);
+      break;
+
+    case Key::ArrowLeft:
+      if (firstColumn > 0)
+        firstColumn--;
+      measureVisible();
+      break;
+    case Key::ArrowRight:
+      if (firstColumn + 1 < columns.size())
+        firstColumn++;
+      measureVisible();
+      break;
 
-        // 清除底部提示符行
-        TermCoord bottom = pos;
-        bottom.Y += static_cast<int>(options.size());
-        clearLineAt(bottom);
-
-        // 重绘 header
-        TermCoord top = pos;
-        top.Y -= 1;
-        moveCursorTo(top);
-        std::cout << ICON_PROMPT(state) << "  " << label << "\033[K";
-
-        // 输出取消项
-        moveCursorTo(pos);
-        std::cout << UTF_VERTICAL_LINE << "  ";
-        size_t i = 0;
-        while (i < options.size() && !selected[i])
-          i++;
-
-        if (i < options.size())
-          std::cout << ANSI_STRIKETHROUGH(ANSI_DIM(options[i].option));
-
-        bool noSelected = (i == options.size());
-
-        for (; ++i < options.size();)
-          if (selected[i])
-            std::cout << ANSI_DIM(", " + ANSI_STRIKETHROUGH(options[i].option));
-
-        std::cout << "\n" << (noSelected ? "": (std::string(UTF_VERTICAL_LINE) + "\n"))
-            << UTF_CORNER_BOTTOM_LEFT
-            << ANSI_RED("  Operation cancelled.") << "\n\n";
-        setCursorVisible(true);
-        exit(1);
+    case Key::Char:
+      // 数字键按对应列排序，再按一次反向
+      if (evt.ch >= '1' && evt.ch <= '9') {
+        int column = evt.ch - '1';
+        sortBy(column, column == sortColumn && !sortDescending);
       }
+      break;
 
-      default:
+    case Key::Enter:
+      if (rowCount == 0)
         break;
+      state = PromptState::Succeed;
+      return PromptResult::Accepted;
+
+    case Key::Escape:
+    case Key::CtrlC:
+      state = PromptState::Failed;
+      return PromptResult::Cancelled;
+
+    default:
+      break;
+  }
+  return PromptResult::Pending;
+}
+
+void CLI_PromptTable::finish(TermFrame &out, PromptResult result) {
+  out << ICON_PROMPT(state) << "  " << label;
+
+  if (result == PromptResult::Accepted) {
+    out << "\n" << UTF_VERTICAL_LINE << "  " << ANSI_DIM(cell(selectedRow(), 0))
+        << "\n" << UTF_VERTICAL_LINE << "\n";
+  } else {
+    if (rowCount)
+      out << "\n" << UTF_VERTICAL_LINE << "  "
+          << ANSI_CANCELLED(cell(selectedRow(), 0));
+    out << "\n" << UTF_VERTICAL_LINE << "\n"
+        << UTF_CORNER_BOTTOM_LEFT << ANSI_RED("  Operation cancelled.")
+        << "\n\n";
+  }
+}
+
+Interactive_CLI::~Interactive_CLI() {
+  if (logAttached)
+    log->attach(nullptr);
+}
+
+void Interactive_CLI::start(TermSession &term) {
+  term.out().setSynchronized(term.caps().synchronizedOutput);
+  if (log) {
+    log->attach(&term);
+    logAttached = true;
+  }
+
+  TermFrame out = term.frame();
+  out << "\033[?25l"; // 隐藏光标
+  out << "\n" << UTF_CORNER_TOP_LEFT << "  " << greeting << "\n";
+  out << UTF_VERTICAL_LINE << "\n";
+  term.commit(out);
+
+  if (!graph) {
+    // 线性流程即一条无条件的链
+    linear = true;
+    graph = std::make_shared<PromptGraph>();
+    for (size_t i = 0; i < prompts.size(); ++i) {
+      std::shared_ptr<CLI_PROMPT> prompt = prompts[i];
+      graph->node(std::to_string(i), [prompt](const Answers &) { return prompt; });
+      if (i > 0)
+        graph->edge(std::to_string(i - 1), std::to_string(i));
+    }
+  }
+
+  // 线性流程的提示是事先构造的同一批对象，只在开始时预填一次
+  if (linear && store)
+    for (const auto &prompt : prompts)
+      if (!prompt->name().empty())
+        prompt->recall(*store, prompt->name());
+
+  path.clear();
+  answers = Answers();
+  outcome = PromptResult::Pending;
+  std::shared_ptr<CLI_PROMPT> first;
+  const size_t node = resolve(graph->start(), first);
+  if (node == PromptGraph::npos) {
+    outcome = PromptResult::Accepted;
+    if (logAttached)
+      log->attach(nullptr);
+    logAttached = false;
+    return;
+  }
+  open(term, node, std::move(first));
+}
+
+size_t Interactive_CLI::resolve(size_t node, std::shared_ptr<CLI_PROMPT> &prompt) const {
+  // 到达节点时才构造提示
+  for (; node != PromptGraph::npos; node = graph->next(node, answers))
+    if ((prompt = graph->make(node, answers)))
+      return node;
+  return PromptGraph::npos;
+}
+
+void Interactive_CLI::open(TermSession &term, size_t node,
+                           std::shared_ptr<CLI_PROMPT> prompt) {
+  path.push_back(Step{node, std::move(prompt), term.transcriptRows()});
+  if (store && !linear)
+    active().recall(*store, graph->id(node));
+  active().begin(term);
+  term.setMouse(active().wantsMouse());
+  term.reserveRows(active().rows());
+  present(term);
+}
+
+std::string Interactive_CLI::storeKey(const Step &step) const {
+  return linear ? step.prompt->name() : graph->id(step.node);
+}
+
+void Interactive_CLI::back(TermSession &term) {
+  if (path.size() < 2)
+    return;
+
+  // 只擦除上一个提示的问答记录（及其后的日志行），从那里重新打开它；
+  // 记录已滚出屏幕时保留原记录，在当前位置重新打开
+  const Step &previous = path[path.size() - 2];
+  term.reclaim(term.transcriptRows() - previous.transcript);
+  TermFrame out = term.frame();
+  out.moveTo(TermCoord{0, 0}) << "\033[J";
+  active().abandon(out);
+  term.commit(out);
+
+  path.pop_back();
+  answers.erase(graph->id(path.back().node));
+  path.back().transcript = term.transcriptRows();
+  active().state = PromptState::Activated;
+  active().begin(term);
+  term.setMouse(active().wantsMouse());
+  term.reserveRows(active().rows());
+  present(term);
+}
+
+void Interactive_CLI::feed(TermSession &term) {
+  KeyEvent evt;
+  bool dirty = false;
+  while (outcome == PromptResult::Pending && !active().busy() &&
+         term.nextKey(evt)) {
+    if (evt.key == Key::BackTab) {
+      back(term);
+      continue;
+    }
+    bool changed = true;
+    PromptResult result;
+    if (is_mouse(evt.key)) {
+      // 大部分移动/滚动事件不改变显示，只在确有变化时重绘
+      changed = false;
+      result = active().handleMouse(term, evt, changed);
+    } else {
+      result = active().handle(term, evt);
     }
+    if (result != PromptResult::Pending)
+      settle(term, result);
+    else
+      dirty = dirty || changed;
   }
+  // 一批按键只重绘一次
+  if (dirty && outcome == PromptResult::Pending)
+    present(term);
 }
 
-void Interactive_CLI::run() {
-  setCursorVisible(false);
+void Interactive_CLI::tick(TermSession &term) {
+  if (outcome != PromptResult::Pending)
+    return;
+  if (log && log->pending())
+    flushLog(term);
+
+  PromptResult result = active().tick(term);
+  if (result != PromptResult::Pending)
+    settle(term, result);
+  else
+    present(term);
+  // 继续处理提示忙碌期间积压的按键
+  feed(term);
+}
 
-  std::cout << "\n" << UTF_CORNER_TOP_LEFT << "  " << greeting << "\n";
-  std::cout << UTF_VERTICAL_LINE << "\n";
+void Interactive_CLI::hangup(TermSession &term) {
+  if (outcome != PromptResult::Pending)
+    return;
+  active().state = PromptState::Failed;
+  settle(term, PromptResult::Cancelled);
+}
+
+void Interactive_CLI::flushLog(TermSession &term) {
+  // 限制刷新频率：未到时间则约定下次唤醒
+  if (LogPane::Clock::now() < log->nextFlush()) {
+    term.wakeAt(log->nextFlush());
+    return;
+  }
+
+  // 日志插入到提示区域上方，之后由 tick() 重绘一次提示
+  TermFrame out = term.frame();
+  out.moveTo(TermCoord{0, 0}) << "\033[J";
+  log->drain(out);
+  term.commit(out);
+  term.reserveRows(active().rows());
+}
 
-  for (size_t i = 0; i < prompts.size(); ++i) {
-    bool isLast = (i == prompts.size() - 1);
-    bool ok = prompts[i]->run(isLast);
+void Interactive_CLI::present(TermSession &term) {
+  TermFrame out = term.frame();
+  active().prompt(out);
+  term.present(out);
+}
 
-    TermCoord up = getCursorPosition();
-    up.Y -= 1;
+void Interactive_CLI::settle(TermSession &term, PromptResult result) {
+  CLI_PROMPT &prompt = active();
+  Step &step = path.back();
 
-    moveCursorTo(up);
-    if (!isLast && prompts[i]->state == PromptState::Succeed) {
-      std::cout << UTF_VERTICAL_LINE << "\n";
+  // 先记下回答，再按回答决定下一个节点
+  size_t next = PromptGraph::npos;
+  std::shared_ptr<CLI_PROMPT> upcoming;
+  if (result == PromptResult::Accepted) {
+    answers.set(graph->id(step.node), prompt.answer());
+    next = resolve(graph->next(step.node, answers), upcoming);
+  }
+  bool isLast = next == PromptGraph::npos;
+
+  // 用问答记录替换整个提示区域
+  TermFrame out = term.frame();
+  out.moveTo(TermCoord{0, 0}) << "\033[J";
+  if (log && log->pending())
+    log->drain(out);
+  step.transcript = term.transcriptRows() + out.cursorRow();
+  prompt.finish(out, result);
+
+  if (result == PromptResult::Accepted) {
+    // 改写记录最后一行的连接线
+    out.moveTo(TermCoord{0, static_cast<decltype(TermCoord::Y)>(out.cursorRow() - 1)});
+    if (!isLast && prompt.state == PromptState::Succeed) {
+      out << UTF_VERTICAL_LINE << "\n";
     } else {
-      std::cout << UTF_CORNER_BOTTOM_LEFT << "\n";
+      out << UTF_CORNER_BOTTOM_LEFT << "\n";
     }
+  }
 
-    if (!ok)
-      break;
+  if (result != PromptResult::Accepted || isLast) {
+    outcome = result;
+    if (store && result == PromptResult::Accepted)
+      for (const Step &done : path)
+        if (!storeKey(done).empty()) {
+          // 每个提示的回答推进一次时钟
+          store->beginAnswer();
+          done.prompt->remember(*store, storeKey(done));
+        }
+    if (logAttached)
+      log->attach(nullptr);
+    logAttached = false;
+    out << "\033[?25h"; // 显示光标
+    term.commit(out);
+    term.setMouse(false);
+    return;
+  }
+
+  term.commit(out);
+  open(term, next, std::move(upcoming));
+}
+
+void Interactive_CLI::run() {
+  {
+    TermSession term(0, 1); // stdin / stdout
+    term.setCaps(term_caps(term));
+
+    // 设置 ARCH_ICLI_RECORD=<file> 时把本次会话录制为 asciicast
+    if (const char *file = std::getenv("ARCH_ICLI_RECORD")) {
+      auto recorder = std::make_shared<SessionRecorder>(file, term.width(), term.lines(),
+                                                        term.caps());
+      if (recorder->ok())
+        term.record(recorder);
+    }
+    start(term);
+
+    while (outcome == PromptResult::Pending) {
+      unsigned ready = term.wait(-1);
+      if ((ready & TermSession::Woken) && term.consumeWake())
+        tick(term);
+      if (ready & TermSession::InputReady) {
+        if (term.readInput())
+          feed(term);
+        else
+          hangup(term);
+      }
+    }
   }
 
-  setCursorVisible(true);
+  if (outcome == PromptResult::Declined)
+    exit(0);
+  if (outcome == PromptResult::Cancelled)
+    exit(1);
 }
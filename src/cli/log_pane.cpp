@@ -0,0 +1,134 @@
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Arch/icli/log_pane.h"
+
+LogPane::LogPane(size_t capacity, int maxFps, size_t maxLines)
+    : interval(std::chrono::duration_cast<Clock::duration>(
+          std::chrono::seconds(1)) / (maxFps > 0 ? maxFps : 1)),
+      maxLines(maxLines ? maxLines : 1) {
+  size_t size = 2;
+  while (size < capacity)
+    size <<= 1;
+  mask = size - 1;
+  slots.reset(new Slot[size]);
+  for (size_t i = 0; i < size; ++i)
+    slots[i].seq.store(i, std::memory_order_relaxed);
+}
+
+LogPane::~LogPane() = default;
+
+void LogPane::attach(TermSession *term) {
+  session.store(term);
+  // 等待已取到旧指针的 push() 唤醒完毕，之后旧会话可以销毁
+  while (waking.load() != 0)
+    std::this_thread::yield();
+  scheduled.store(false);
+  if (term && pending())
+    term->wake();
+}
+
+bool LogPane::push(std::string line) {
+  // 有界 MPMC 队列（序号槽位）：每个槽位的 seq 表示它当前可被哪一轮写入/读取
+  size_t pos = head.load(std::memory_order_relaxed);
+  Slot *slot;
+  while (true) {
+    slot = &slots[pos & mask];
+    size_t seq = slot->seq.load(std::memory_order_acquire);
+    intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = head.load(std::memory_order_relaxed);
+    }
+  }
+  slot->line = std::move(line);
+  slot->seq.store(pos + 1, std::memory_order_release);
+
+  // 每次刷新只唤醒一次会话；wake() 本身只是原子标记加一次 fd 写入
+  if (!scheduled.exchange(true)) {
+    waking.fetch_add(1);
+    if (TermSession *term = session.load())
+      term->wake();
+    waking.fetch_sub(1);
+  }
+  return true;
+}
+
+// 按终端宽度把一行拆成多个屏幕行写出，帧的行号因此与屏幕一致（CSI 序列不占列）
+static void write_wrapped(TermFrame &out, const std::string &line) {
+  const size_t width = out.width() > 0 ? static_cast<size_t>(out.width()) : 80;
+  size_t begin = 0, cols = 0;
+  for (size_t i = 0; i < line.size();) {
+    unsigned char ch = static_cast<unsigned char>(line[i]);
+    if (ch == 27 && i + 1 < line.size() && line[i + 1] == '[') {
+      i += 2;
+      while (i < line.size() && (line[i] < 0x40 || line[i] > 0x7e))
+        ++i;
+      ++i;
+    } else if (ch == '\n') {
+      cols = 0;
+      ++i;
+    } else {
+      const size_t at = i;
+      const size_t w = static_cast<size_t>(codepoint_width(next_codepoint(line, i)));
+      // 放不下时先换行再写（宽字符不拆开），不依赖终端的自动折行
+      if (cols + w > width && cols > 0) {
+        out << line.substr(begin, at - begin) << "\n";
+        begin = at;
+        cols = 0;
+      }
+      cols += w;
+    }
+  }
+  out << line.substr(begin) << "\033[K\n";
+}
+
+bool LogPane::pending() const {
+  return slots[tail & mask].seq.load(std::memory_order_acquire) == tail + 1 ||
+         skipped() != reported;
+}
+
+size_t LogPane::drain(TermFrame &out) {
+  // 先清除标记，之后写入的行会重新唤醒会话
+  scheduled.store(false);
+  lastFlush = Clock::now();
+
+  // 只保留最后 maxLines 行；一次最多取一整圈，避免被持续写入拖住
+  std::vector<std::string> keep;
+  size_t count = 0;
+  for (size_t n = 0; n <= mask; ++n) {
+    Slot &slot = slots[tail & mask];
+    if (slot.seq.load(std::memory_order_acquire) != tail + 1)
+      break;
+    if (keep.size() < maxLines)
+      keep.push_back(std::move(slot.line));
+    else
+      keep[count % maxLines] = std::move(slot.line);
+    slot.line.clear();
+    slot.seq.store(tail + mask + 1, std::memory_order_release);
+    ++tail;
+    ++count;
+  }
+  if (count > maxLines)
+    elided += count - maxLines;
+
+  size_t total = skipped();
+  if (total != reported) {
+    write_wrapped(out, ANSI_DIM("… " + std::to_string(total - reported) +
+                                " log lines skipped"));
+    reported = total;
+  }
+
+  size_t first = count > maxLines ? count % maxLines : 0;
+  for (size_t i = 0; i < keep.size(); ++i)
+    write_wrapped(out, keep[(first + i) % keep.size()]);
+  return keep.size();
+}
@@ -0,0 +1,50 @@
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "Arch/icli/prompt_graph.h"
+
+bool Answers::contains(const std::string &id, const std::string &option) const {
+  const auto *answer = get<std::vector<std::string>>(id);
+  return answer && std::find(answer->begin(), answer->end(), option) != answer->end();
+}
+
+PromptGraph::Node &PromptGraph::slot(const std::string &id) {
+  auto it = index.find(id);
+  if (it != index.end())
+    return nodes[it->second];
+  index.emplace(id, nodes.size());
+  nodes.push_back(Node{id, nullptr, {}});
+  return nodes.back();
+}
+
+PromptGraph &PromptGraph::node(const std::string &id, Factory make) {
+  Node &target = slot(id);
+  target.make = std::move(make);
+  if (first == npos)
+    first = index[id];
+  return *this;
+}
+
+PromptGraph &PromptGraph::edge(const std::string &from, const std::string &to,
+                               Condition when) {
+  slot(to);
+  slot(from).edges.push_back(Edge{to, std::move(when)});
+  return *this;
+}
+
+size_t PromptGraph::find(const std::string &id) const {
+  auto it = index.find(id);
+  return it == index.end() ? npos : it->second;
+}
+
+size_t PromptGraph::next(size_t from, const Answers &answers) const {
+  for (const Edge &edge : nodes[from].edges) {
+    size_t to = find(edge.to);
+    if (!nodes[to].make)
+      continue;
+    if (!edge.when || edge.when(answers))
+      return to;
+  }
+  return npos;
+}
@@ -0,0 +1,196 @@
+#include <cerrno>
+#include <cstdint>
+#include <utility>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "Arch/icli/session_executor.h"
+
+// epoll data: 会话 id << 2 | fd 类型
+enum : unsigned { KindInput = 0, KindWake = 1, KindOutput = 2, KindTimer = 3 };
+static const uint64_t STOP_TOKEN = ~uint64_t(0);
+
+struct SessionExecutor::Entry {
+  uint64_t id;
+  std::mutex mu;
+  std::unique_ptr<TermSession> term;
+  std::unique_ptr<Interactive_CLI> cli;
+  DoneCallback onDone;
+  bool done = false;
+  // 各 fd 当前注册的事件（按 fd 类型），DISARMED 表示 ONESHOT 已触发而失效
+  uint32_t armed[4] = {};
+};
+
+static const uint32_t DISARMED = ~uint32_t(0);
+
+SessionExecutor::SessionExecutor(unsigned threads) {
+  epfd = epoll_create1(EPOLL_CLOEXEC);
+  stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  // 停止事件不用 ONESHOT：写一次即可让所有线程看到
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.u64 = STOP_TOKEN;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, stopFd, &ev);
+
+  if (threads == 0)
+    threads = 1;
+  for (unsigned i = 0; i < threads; ++i)
+    pool.emplace_back(&SessionExecutor::worker, this);
+}
+
+SessionExecutor::~SessionExecutor() {
+  uint64_t one = 1;
+  ssize_t n = ::write(stopFd, &one, sizeof(one));
+  (void)n;
+  for (std::thread &t : pool)
+    t.join();
+
+  // 只写出 fd 立即接受的部分：对端停止读取的会话不能拖住关闭
+  for (auto &item : sessions)
+    if (item.second->term)
+      item.second->term->out().flush(0);
+  sessions.clear();
+  close(stopFd);
+  close(epfd);
+}
+
+void SessionExecutor::arm(Entry &entry, int op) {
+  TermSession &term = *entry.term;
+  const bool settled = entry.cli->outcome != PromptResult::Pending;
+  const bool backlog = term.out().backlog();
+  const bool sharedFd = term.inFd() == term.outFd();
+  const uint32_t in = EPOLLIN, out = EPOLLOUT, hangup = EPOLLRDHUP;
+
+  // 会话结束后只等待输出写完，不再读输入；EPOLLOUT 只在有积压时注册
+  const int fds[4] = {term.inFd(), term.wakeFd(), sharedFd ? -1 : term.outFd(),
+                      term.timerFd()};
+  const uint32_t want[4] = {(settled ? 0 : in | hangup) | (sharedFd && backlog ? out : 0),
+                            in, backlog ? out : 0, in};
+
+  // 只重新设置刚触发（已失效）或所需事件有变化的 fd
+  for (unsigned kind = 0; kind < 4; ++kind) {
+    if (fds[kind] < 0 || (op == EPOLL_CTL_MOD && entry.armed[kind] == want[kind]))
+      continue;
+    struct epoll_event ev = {};
+    ev.events = EPOLLONESHOT | want[kind];
+    ev.data.u64 = entry.id << 2 | kind;
+    epoll_ctl(epfd, op, fds[kind], &ev);
+    entry.armed[kind] = want[kind];
+  }
+}
+
+void SessionExecutor::add(std::unique_ptr<TermSession> term,
+                          std::unique_ptr<Interactive_CLI> cli,
+                          DoneCallback onDone) {
+  auto entry = std::make_shared<Entry>();
+  entry->term = std::move(term);
+  entry->cli = std::move(cli);
+  entry->onDone = std::move(onDone);
+
+  // 注册后事件可能立刻在其他线程上到达，先持有会话锁
+  std::unique_lock<std::mutex> lock(entry->mu);
+  {
+    std::lock_guard<std::mutex> guard(mu);
+    entry->id = nextId++;
+    sessions.emplace(entry->id, entry);
+  }
+  entry->cli->start(*entry->term);
+  arm(*entry, EPOLL_CTL_ADD);
+  lock.unlock();
+
+  // 没有提示项的会话在 start() 中就已结束
+  handle(entry, KindOutput, 0);
+}
+
+size_t SessionExecutor::active() const {
+  std::lock_guard<std::mutex> lock(mu);
+  return sessions.size();
+}
+
+void SessionExecutor::wait() {
+  std::unique_lock<std::mutex> lock(mu);
+  idle.wait(lock, [this] { return sessions.empty(); });
+}
+
+void SessionExecutor::handle(const std::shared_ptr<Entry> &entry,
+                             unsigned kind, uint32_t events) {
+  std::unique_lock<std::mutex> lock(entry->mu);
+  if (entry->done)
+    return;
+  TermSession &term = *entry->term;
+  Interactive_CLI &cli = *entry->cli;
+  if (events)
+    entry->armed[kind] = DISARMED;
+
+  if (events & (EPOLLOUT | EPOLLERR))
+    term.out().pump();
+
+  if (kind == KindInput &&
+      (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+    if (term.readInput())
+      cli.feed(term);
+    else
+      cli.hangup(term);
+  }
+
+  if ((kind == KindWake || kind == KindTimer) && term.consumeWake())
+    cli.tick(term);
+
+  if (cli.outcome == PromptResult::Pending || term.out().backlog()) {
+    arm(*entry, EPOLL_CTL_MOD);
+    return;
+  }
+
+  // 问答记录已写完：注销并销毁会话
+  entry->done = true;
+  epoll_ctl(epfd, EPOLL_CTL_DEL, term.inFd(), nullptr);
+  epoll_ctl(epfd, EPOLL_CTL_DEL, term.wakeFd(), nullptr);
+  if (term.timerFd() >= 0)
+    epoll_ctl(epfd, EPOLL_CTL_DEL, term.timerFd(), nullptr);
+  if (term.outFd() != term.inFd())
+    epoll_ctl(epfd, EPOLL_CTL_DEL, term.outFd(), nullptr);
+
+  PromptResult outcome = cli.outcome;
+  DoneCallback onDone = std::move(entry->onDone);
+  entry->cli.reset();
+  entry->term.reset();
+  lock.unlock();
+
+  if (onDone)
+    onDone(outcome);
+
+  std::lock_guard<std::mutex> guard(mu);
+  sessions.erase(entry->id);
+  if (sessions.empty())
+    idle.notify_all();
+}
+
+void SessionExecutor::worker() {
+  struct epoll_event events[64];
+  while (true) {
+    int n = epoll_wait(epfd, events, 64, -1);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return;
+
+    for (int i = 0; i < n; ++i) {
+      if (events[i].data.u64 == STOP_TOKEN)
+        return;
+
+      uint64_t id = events[i].data.u64 >> 2;
+      std::shared_ptr<Entry> entry;
+      {
+        std::lock_guard<std::mutex> lock(mu);
+        auto it = sessions.find(id);
+        if (it == sessions.end())
+          continue;
+        entry = it->second;
+      }
+      handle(entry, static_cast<unsigned>(events[i].data.u64 & 3), events[i].events);
+    }
+  }
+}
@@ -0,0 +1,201 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <utility>
+
+#include "Arch/icli/session_recorder.h"
+
+// 缓冲记录格式：int64 纳秒 | 类型字节 | uint32 长度 | 数据
+struct RecordHeader {
+  int64_t ns;
+  char kind;
+  uint32_t len;
+};
+
+// 超过该大小时提前唤醒写线程
+static const size_t FLUSH_BYTES = 64 * 1024;
+
+// s[i] 起完整合法的 UTF-8 序列长度，非法（含过长编码、代理项）时为 0
+static size_t utf8_sequence(const std::string &s, size_t i) {
+  const unsigned char lead = static_cast<unsigned char>(s[i]);
+  size_t len;
+  unsigned char lo = 0x80, hi = 0xbf; // 第二个字节的范围
+  if (lead >= 0xc2 && lead <= 0xdf) {
+    len = 2;
+  } else if (lead >= 0xe0 && lead <= 0xef) {
+    len = 3;
+    if (lead == 0xe0)
+      lo = 0xa0;
+    else if (lead == 0xed)
+      hi = 0x9f;
+  } else if (lead >= 0xf0 && lead <= 0xf4) {
+    len = 4;
+    if (lead == 0xf0)
+      lo = 0x90;
+    else if (lead == 0xf4)
+      hi = 0x8f;
+  } else {
+    return 0;
+  }
+  if (i + len > s.size())
+    return 0;
+  for (size_t k = 1; k < len; ++k) {
+    const unsigned char ch = static_cast<unsigned char>(s[i + k]);
+    if (ch < (k == 1 ? lo : 0x80) || ch > (k == 1 ? hi : 0xbf))
+      return 0;
+  }
+  return len;
+}
+
+static void append_json_string(std::string &out, const std::string &s) {
+  static const char hex[] = "0123456789abcdef";
+  out += '"';
+  for (size_t i = 0; i < s.size();) {
+    const unsigned char ch = static_cast<unsigned char>(s[i]);
+    if (ch >= 0x80) {
+      // JSON 字符串只能是 UTF-8：非法字节逐个替换为 U+FFFD
+      const size_t len = utf8_sequence(s, i);
+      if (len == 0) {
+        out += "\\ufffd";
+        ++i;
+      } else {
+        out.append(s, i, len);
+        i += len;
+      }
+      continue;
+    }
+    if (ch == '"' || ch == '\\') {
+      out += '\\';
+      out += static_cast<char>(ch);
+    } else if (ch == '\n') {
+      out += "\\n";
+    } else if (ch == '\r') {
+      out += "\\r";
+    } else if (ch == '\t') {
+      out += "\\t";
+    } else if (ch < 0x20 || ch == 0x7f) {
+      out += "\\u00";
+      out += hex[ch >> 4];
+      out += hex[ch & 15];
+    } else {
+      out += static_cast<char>(ch);
+    }
+    ++i;
+  }
+  out += '"';
+}
+
+SessionRecorder::SessionRecorder(const std::string &path, int width, int height,
+                                 const TermCaps &caps)
+    : start(Clock::now()) {
+  file = std::fopen(path.c_str(), "w");
+  if (!file)
+    return;
+
+  const char *term = std::getenv("TERM");
+  std::string header = "{\"version\": 2, \"width\": " + std::to_string(width) +
+                       ", \"height\": " + std::to_string(height) +
+                       ", \"timestamp\": " + std::to_string(std::time(nullptr)) +
+                       ", \"env\": {\"TERM\": ";
+  append_json_string(header, term ? term : "");
+  header += "}, \"arch_termcaps\": ";
+  append_json_string(header, format_term_caps(caps));
+  header += "}\n";
+  std::fwrite(header.data(), 1, header.size(), file);
+
+  thread = std::thread(&SessionRecorder::worker, this);
+}
+
+SessionRecorder::~SessionRecorder() {
+  if (!file)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    stop = true;
+  }
+  cv.notify_all();
+  thread.join();
+  std::fclose(file);
+}
+
+void SessionRecorder::record(char kind, const char *data, size_t len) {
+  if (!file || len == 0)
+    return;
+  RecordHeader head{std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        Clock::now() - start).count(),
+                    kind, static_cast<uint32_t>(len)};
+
+  bool wake;
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    buffer.append(reinterpret_cast<const char *>(&head), sizeof(head));
+    buffer.append(data, len);
+    wake = buffer.size() >= FLUSH_BYTES;
+  }
+  if (wake)
+    cv.notify_one();
+}
+
+void SessionRecorder::worker() {
+  std::string records;
+  std::unique_lock<std::mutex> lock(mu);
+  while (true) {
+    // 定期批量写出；录制结束或积压较多时立即写
+    cv.wait_for(lock, std::chrono::milliseconds(50),
+                [this] { return stop || buffer.size() >= FLUSH_BYTES; });
+    records.swap(buffer);
+    bool last = stop;
+    lock.unlock();
+
+    encode(records);
+    records.clear();
+    std::fflush(file);
+
+    lock.lock();
+    if (last && buffer.empty())
+      return;
+  }
+}
+
+// UTF-8 序列末尾不完整的字节数（留到下一条同类记录）
+static size_t incomplete_tail(const std::string &s) {
+  size_t n = s.size();
+  for (size_t back = 1; back <= 3 && back <= n; ++back) {
+    unsigned char ch = static_cast<unsigned char>(s[n - back]);
+    if ((ch & 0xC0) == 0x80)
+      continue;
+    size_t need = ch >= 0xF0 ? 4 : ch >= 0xE0 ? 3 : ch >= 0xC0 ? 2 : 1;
+    return need > back ? back : 0;
+  }
+  return 0;
+}
+
+void SessionRecorder::encode(const std::string &records) {
+  size_t pos = 0;
+  while (pos + sizeof(RecordHeader) <= records.size()) {
+    RecordHeader head;
+    std::memcpy(&head, records.data() + pos, sizeof(head));
+    pos += sizeof(head);
+
+    std::string &pending = carry[head.kind == 'i' ? 0 : 1];
+    pending.append(records, pos, head.len);
+    pos += head.len;
+
+    size_t tail = incomplete_tail(pending);
+    std::string text = pending.substr(0, pending.size() - tail);
+    pending.erase(0, pending.size() - tail);
+    if (text.empty())
+      continue;
+
+    char time[32];
+    std::snprintf(time, sizeof(time), "%.6f", head.ns / 1e9);
+    line.assign("[");
+    line += time;
+    line += head.kind == 'i' ? ", \"i\", " : ", \"o\", ";
+    append_json_string(line, text);
+    line += "]\n";
+    std::fwrite(line.data(), 1, line.size(), file);
+  }
+}
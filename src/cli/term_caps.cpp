@@ -0,0 +1,211 @@
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "Arch/icli/term_caps.h"
+#include "Arch/icli/term_session.h"
+#include "Arch/icli/terminal_utils.h"
+
+static bool env_truecolor() {
+  const char *colorterm = std::getenv("COLORTERM");
+  return colorterm && (std::strcmp(colorterm, "truecolor") == 0 ||
+                       std::strcmp(colorterm, "24bit") == 0);
+}
+
+#ifdef _WIN32
+
+TermCaps probe_term_caps(TermSession &, bool *answered) {
+  if (answered)
+    *answered = false;
+  return TermCaps();
+}
+
+std::string term_caps_cache_path() { return ""; }
+
+#else  // POSIX
+#include <poll.h>
+#include <unistd.h>
+
+// DECRPM 应答 "\033[?<mode>;<value>$y"：1/2 表示可设置，3 表示永久开启，
+// 0 不认识、4 永久关闭都视为不支持
+static bool mode_supported(const std::string &reply, const char *mode) {
+  std::string prefix = std::string("\033[?") + mode + ";";
+  size_t at = reply.find(prefix);
+  if (at == std::string::npos || at + prefix.size() >= reply.size())
+    return false;
+  char value = reply[at + prefix.size()];
+  return value == '1' || value == '2' || value == '3';
+}
+
+// 终端对 DA1 必然应答，收到即可停止等待，无需总是耗尽超时
+static bool has_da1_reply(const std::string &reply) {
+  for (size_t at = reply.find("\033[?"); at != std::string::npos;
+       at = reply.find("\033[?", at + 1)) {
+    size_t i = at + 3;
+    while (i < reply.size() && (isdigit(static_cast<unsigned char>(reply[i])) ||
+                                reply[i] == ';'))
+      ++i;
+    if (i < reply.size() && reply[i] == 'c')
+      return true;
+  }
+  return false;
+}
+
+// 把应答之外的字节（探测期间的预输入）交还给会话的按键解析
+static void push_back_typeahead(TermSession &term, const std::string &reply) {
+  std::string typeahead;
+  size_t i = 0;
+  while (i < reply.size()) {
+    if (reply.compare(i, 3, "\033[?") == 0) {
+      size_t end = i + 3;
+      while (end < reply.size() && !(reply[end] >= 0x40 && reply[end] <= 0x7e))
+        ++end;
+      i = end + 1;
+    } else if (reply.compare(i, 2, "\033P") == 0) {
+      size_t end = reply.find("\033\\", i);
+      i = end == std::string::npos ? reply.size() : end + 2;
+    } else {
+      typeahead += reply[i++];
+    }
+  }
+  term.pushInput(typeahead);
+}
+
+TermCaps probe_term_caps(TermSession &term, bool *answered) {
+  TermCaps caps;
+  if (answered)
+    *answered = false;
+  if (!isatty(term.inFd()) || !isatty(term.outFd()))
+    return caps;
+
+  // 会话已把 tty 置为 raw；查询与提示输出走同一个 writer，字节不会交错
+
+  // 24 位色：设一个背景色再用 DECRQSS 读回，随后复位
+  std::string query = "\033[?2026$p\033[?2004$p"
+                      "\033[48:2:1:2:3m\033P$qm\033\\\033[0m"
+                      "\033[c";
+  const int timeout_ms = 200;
+  term.out().write(query);
+  term.out().flush(timeout_ms);
+
+  std::string reply;
+  int waited = 0;
+  while (!has_da1_reply(reply) && waited < timeout_ms) {
+    struct pollfd pfd = {term.inFd(), POLLIN, 0};
+    if (poll(&pfd, 1, 10) <= 0) {
+      waited += 10;
+      continue;
+    }
+    char buf[256];
+    ssize_t n = read(term.inFd(), buf, sizeof(buf));
+    if (n <= 0)
+      break;
+    reply.append(buf, static_cast<size_t>(n));
+  }
+
+  if (answered)
+    *answered = has_da1_reply(reply);
+  caps.synchronizedOutput = mode_supported(reply, "2026");
+  caps.bracketedPaste = mode_supported(reply, "2004");
+  caps.truecolor = reply.find("48:2:1:2:3") != std::string::npos ||
+                   reply.find("48;2;1;2;3") != std::string::npos;
+
+  // VT220 及以上（?62 起）的终端都支持 CNL/CPL/CHA
+  size_t da = reply.rfind("\033[?");
+  caps.lineMotion = da != std::string::npos && has_da1_reply(reply) &&
+                    std::atoi(reply.c_str() + da + 3) >= 62;
+
+  push_back_typeahead(term, reply);
+  return caps;
+}
+
+std::string term_caps_cache_path() {
+  const char *term = std::getenv("TERM");
+  if (!term || !*term || std::strcmp(term, "dumb") == 0)
+    return "";
+
+  std::string dir;
+  if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+    dir = xdg;
+  else if (const char *home = std::getenv("HOME"); home && *home)
+    dir = std::string(home) + "/.cache";
+  else
+    return "";
+
+  std::string name = term;
+  for (char &c : name)
+    if (c == '/')
+      c = '_';
+  return dir + "/arch/termcaps/" + name;
+}
+#endif
+
+static bool load_cached(const std::string &path, TermCaps &caps) {
+  std::ifstream in(path);
+  if (!in)
+    return false;
+
+  std::string line;
+  int fields = 0;
+  while (std::getline(in, line)) {
+    size_t eq = line.find('=');
+    if (eq == std::string::npos)
+      continue;
+    std::string key = line.substr(0, eq);
+    bool value = line.compare(eq + 1, std::string::npos, "1") == 0;
+    if (key == "synchronized_output")
+      caps.synchronizedOutput = value;
+    else if (key == "bracketed_paste")
+      caps.bracketedPaste = value;
+    else if (key == "truecolor")
+      caps.truecolor = value;
+    else if (key == "line_motion")
+      caps.lineMotion = value;
+    else
+      continue;
+    ++fields;
+  }
+  return fields == 4;
+}
+
+static void store_cached(const std::string &path, const TermCaps &caps) {
+  std::error_code ec;
+  std::filesystem::create_directories(
+      std::filesystem::path(path).parent_path(), ec);
+  if (ec)
+    return;
+
+  std::ofstream out(path, std::ios::trunc);
+  out << format_term_caps(caps);
+}
+
+std::string format_term_caps(const TermCaps &caps) {
+  auto field = [](const char *key, bool value) {
+    return std::string(key) + (value ? "=1\n" : "=0\n");
+  };
+  return field("synchronized_output", caps.synchronizedOutput) +
+         field("bracketed_paste", caps.bracketedPaste) +
+         field("truecolor", caps.truecolor) +
+         field("line_motion", caps.lineMotion);
+}
+
+const TermCaps &term_caps(TermSession &term) {
+  static const TermCaps caps = [&term] {
+    TermCaps detected;
+    std::string path = term_caps_cache_path();
+    if (path.empty() || !load_cached(path, detected)) {
+      bool answered = false;
+      detected = probe_term_caps(term, &answered);
+      // 没有应答（不是终端、超时）时结果没有意义，不写缓存，下次重新探测
+      if (!path.empty() && answered)
+        store_cached(path, detected);
+    }
+    // 环境变量只对本进程有效，不进入按 $TERM 共享的缓存
+    detected.truecolor = detected.truecolor || env_truecolor();
+    return detected;
+  }();
+  return caps;
+}
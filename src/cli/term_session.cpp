@@ -0,0 +1,438 @@
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "Arch/icli/term_session.h"
+
+#ifdef _WIN32
+#include <conio.h>
+#include <windows.h>
+
+// Windows 控制台没有可 poll 的 fd：按键经 _getch 转成 VT 字节序列再解码
+TermSession::TermSession(int in, int out, TermCaps caps)
+    : in(in), writer(out), termCaps(caps) {}
+
+TermSession::~TermSession() {
+  setMouse(false);
+  writer.observe(nullptr);
+}
+
+int TermSession::width() const {
+  CONSOLE_SCREEN_BUFFER_INFO csbi;
+  if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi))
+    return csbi.srWindow.Right - csbi.srWindow.Left + 1;
+  return 80;
+}
+
+int TermSession::lines() const {
+  CONSOLE_SCREEN_BUFFER_INFO csbi;
+  if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi))
+    return csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
+  return 24;
+}
+
+bool TermSession::readInput() {
+  while (_kbhit()) {
+    int ch = _getch();
+    if (ch == 0 || ch == 224) {
+      const char *seq = "";
+      switch (_getch()) {
+        case 72: seq = "\033[A"; break;
+        case 80: seq = "\033[B"; break;
+        case 77: seq = "\033[C"; break;
+        case 75: seq = "\033[D"; break;
+        case 73: seq = "\033[5~"; break;
+        case 81: seq = "\033[6~"; break;
+        case 71: seq = "\033[H"; break;
+        case 79: seq = "\033[F"; break;
+        case 15: seq = "\033[Z"; break;
+      }
+      keys.feed(seq, std::char_traits<char>::length(seq));
+      if (recorder)
+        recorder->input(seq, std::char_traits<char>::length(seq));
+    } else {
+      char byte = ch == 8 ? 127 : static_cast<char>(ch);
+      keys.feed(&byte, 1);
+      if (recorder)
+        recorder->input(&byte, 1);
+    }
+  }
+  return true;
+}
+
+void TermSession::wake() { woken.store(true); }
+
+void TermSession::wakeAt(Clock::time_point when) {
+  if (hasDeadline && deadline <= when)
+    return;
+  hasDeadline = true;
+  deadline = when;
+}
+
+bool TermSession::consumeWake() {
+  bool fired = woken.exchange(false);
+  if (hasDeadline && Clock::now() >= deadline) {
+    hasDeadline = false;
+    fired = true;
+  }
+  return fired;
+}
+
+unsigned TermSession::wait(int timeout_ms) {
+  for (int waited = 0; timeout_ms < 0 || waited < timeout_ms; ++waited) {
+    bool due = hasDeadline && Clock::now() >= deadline;
+    unsigned ready = (_kbhit() ? InputReady : 0) | (woken.load() || due ? Woken : 0);
+    if (ready)
+      return ready;
+    Sleep(1);
+  }
+  return 0;
+}
+
+#else  // POSIX
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <csignal>
+#include <mutex>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
+
+// 返回原来的文件状态标志，失败时为 -1
+static int set_nonblocking(int fd) {
+  int flags = fcntl(fd, F_GETFL);
+  if (flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0)
+    return -1;
+  return flags;
+}
+
+// SIGWINCH 计数：信号处理函数只做原子加一，各会话在 wait() 中比较
+static std::atomic<unsigned> resize_count{0};
+static struct sigaction previous_winch;
+
+static void on_winch(int sig) {
+  resize_count.fetch_add(1, std::memory_order_relaxed);
+  // 保留程序原有的处理函数
+  if (!(previous_winch.sa_flags & SA_SIGINFO) &&
+      previous_winch.sa_handler != SIG_DFL && previous_winch.sa_handler != SIG_IGN)
+    previous_winch.sa_handler(sig);
+}
+
+static void watch_resize() {
+  static std::once_flag once;
+  std::call_once(once, [] {
+    struct sigaction action = {};
+    action.sa_handler = on_winch;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGWINCH, &action, &previous_winch);
+  });
+}
+
+TermSession::TermSession(int in, int out, TermCaps caps)
+    : in(in), writer(out), termCaps(caps) {
+  if (isatty(in)) {
+    // 整个会话保持 raw，按键不会在重绘间隙被回显或按行缓冲
+    if (term_getattr(in, &saved) == 0) {
+      struct termios raw = saved;
+      raw.c_lflag &= ~(ICANON | ECHO);
+      rawMode = term_setattr(in, &raw) == 0;
+    }
+  } else {
+    inFlags = set_nonblocking(in);
+  }
+  if (!isatty(out) && out > STDERR_FILENO)
+    outFlags = set_nonblocking(out);
+
+  struct stat st;
+  crlf = fstat(out, &st) == 0 && S_ISSOCK(st.st_mode);
+
+  if (isatty(out))
+    watch_resize();
+  seenResize = resize_count.load(std::memory_order_relaxed);
+  resized();
+
+#ifdef __linux__
+  wakeRead = wakeWrite = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+#else
+  int fds[2];
+  if (pipe(fds) == 0) {
+    wakeRead = fds[0];
+    wakeWrite = fds[1];
+    set_nonblocking(wakeRead);
+    set_nonblocking(wakeWrite);
+  }
+#endif
+}
+
+TermSession::~TermSession() {
+  setMouse(false);
+  // 对端不再读取时（客户端断开、pty 卡住）丢弃积压，只恢复终端模式
+  writer.flush(TermWriter::closeTimeoutMs);
+  writer.observe(nullptr);
+  if (rawMode)
+    term_setattr(in, &saved);
+  // 与 termios 一样恢复 fd 原来的阻塞模式；in 与 out 相同时 inFlags 才是原值
+  if (outFlags >= 0)
+    fcntl(writer.fd(), F_SETFL, outFlags);
+  if (inFlags >= 0)
+    fcntl(in, F_SETFL, inFlags);
+  if (wakeRead >= 0)
+    close(wakeRead);
+  if (wakeWrite >= 0 && wakeWrite != wakeRead)
+    close(wakeWrite);
+  if (timer >= 0)
+    close(timer);
+}
+
+int TermSession::width() const { return cols; }
+
+int TermSession::lines() const { return screenRows; }
+
+void TermSession::resized() {
+  struct winsize ws;
+  if (ioctl(writer.fd(), TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+    cols = ws.ws_col;
+    screenRows = ws.ws_row;
+  }
+  shown.clear();
+  anchorStale();
+}
+
+bool TermSession::readInput() {
+  char buf[512];
+  while (true) {
+    ssize_t n = read(in, buf, sizeof(buf));
+    if (n > 0) {
+      keys.feed(buf, static_cast<size_t>(n));
+      if (recorder)
+        recorder->input(buf, static_cast<size_t>(n));
+      // tty 一次只给出已到达的字节，无需继续读到 EAGAIN
+      if (static_cast<size_t>(n) < sizeof(buf) || rawMode)
+        return true;
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return true;
+    } else {
+      return false;
+    }
+  }
+}
+
+void TermSession::wake() {
+  // 已有未处理的唤醒时不再重复写
+  if (woken.exchange(true))
+    return;
+#ifdef __linux__
+  uint64_t one = 1;
+  ssize_t n = ::write(wakeWrite, &one, sizeof(one));
+#else
+  char one = 1;
+  ssize_t n = ::write(wakeWrite, &one, 1);
+#endif
+  (void)n;
+}
+
+void TermSession::wakeAt(Clock::time_point when) {
+  if (hasDeadline && deadline <= when)
+    return;
+  hasDeadline = true;
+  deadline = when;
+#ifdef __linux__
+  // steady_clock 即 CLOCK_MONOTONIC
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      when.time_since_epoch()).count();
+  struct itimerspec spec = {};
+  spec.it_value.tv_sec = ns / 1000000000;
+  spec.it_value.tv_nsec = ns % 1000000000;
+  if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+    spec.it_value.tv_nsec = 1;
+  timerfd_settime(timer, TFD_TIMER_ABSTIME, &spec, nullptr);
+#endif
+}
+
+bool TermSession::consumeWake() {
+  bool fired = false;
+  char buf[64];
+  if (woken.load()) {
+    // 先读空 fd 再清标记：读空期间的 wake() 看到标记仍在，不写 fd，由本轮处理；
+    // 清标记之后的 wake() 必然重新写 fd。反过来会读掉新写入而标记留在 true，
+    // 之后所有 wake() 都不再写 fd
+    while (read(wakeRead, buf, sizeof(buf)) > 0) {}
+    fired = woken.exchange(false);
+  }
+  if (hasDeadline && Clock::now() >= deadline) {
+    hasDeadline = false;
+    if (timer >= 0)
+      while (read(timer, buf, sizeof(buf)) > 0) {}
+    fired = true;
+  }
+  return fired;
+}
+
+unsigned TermSession::wait(int timeout_ms) {
+  const Clock::time_point until =
+      Clock::now() + std::chrono::milliseconds(timeout_ms < 0 ? 0 : timeout_ms);
+
+  while (true) {
+    struct pollfd fds[3] = {{in, POLLIN, 0},
+                            {wakeRead, POLLIN, 0},
+                            {writer.fd(), POLLOUT, 0}};
+    // 取调用者超时与 wakeAt() 期限中较早者
+    int wait = -1;
+    if (timeout_ms >= 0 || hasDeadline) {
+      Clock::time_point end = timeout_ms < 0 ? deadline
+                              : hasDeadline  ? std::min(until, deadline)
+                                             : until;
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          end - Clock::now() + std::chrono::microseconds(999));
+      wait = left.count() > 0 ? static_cast<int>(left.count()) : 0;
+    }
+
+    // 窗口大小变化（信号可能在 poll 之外到达）：当作一次唤醒，由 tick() 重绘
+    unsigned count = resize_count.load(std::memory_order_relaxed);
+    if (count != seenResize) {
+      seenResize = count;
+      resized();
+      // 经由 wake() 同时写 fd，标记与 fd 保持一致
+      wake();
+      return Woken;
+    }
+
+    int rc = poll(fds, writer.backlog() ? 3 : 2, wait);
+    if (rc < 0 && errno == EINTR)
+      continue;
+    if (rc == 0 && hasDeadline && Clock::now() >= deadline)
+      return Woken;
+    if (rc <= 0)
+      return 0;
+    if (fds[2].revents)
+      writer.pump();
+
+    unsigned ready = (fds[0].revents ? unsigned(InputReady) : 0u) |
+                     (fds[1].revents ? unsigned(Woken) : 0u);
+    if (ready)
+      return ready;
+  }
+}
+#endif
+
+void TermSession::record(std::shared_ptr<SessionRecorder> rec) {
+  recorder = std::move(rec);
+  if (!recorder) {
+    writer.observe(nullptr);
+    return;
+  }
+  SessionRecorder *target = recorder.get();
+  writer.observe([target](const char *data, size_t len) {
+    target->output(data, len);
+  });
+}
+
+void TermSession::pushInput(const std::string &bytes) {
+  keys.feed(bytes.data(), bytes.size());
+}
+
+bool TermSession::nextKey(KeyEvent &evt) {
+  // 一次读入可能截断在序列中间（鼠标事件成批到达时很常见）：先等剩余字节
+  const bool idle = escWaiting && Clock::now() >= escDeadline;
+  while (keys.next(evt, idle)) {
+    escWaiting = false;
+    if (evt.key == Key::CursorReport) {
+      if (cprPending > 0)
+        --cprPending;
+      if (cprIgnore > 0) {
+        --cprIgnore;
+        continue;
+      }
+      // 查询时光标停在区域最后一行
+      anchorTop = evt.y - (height - 1);
+      anchorKnown = true;
+      continue;
+    }
+    if (is_mouse(evt.key)) {
+      if (!mouse || !anchorKnown)
+        continue;
+      evt.y -= anchorTop;
+    }
+    return true;
+  }
+  if (keys.buffered() && !escWaiting) {
+    escWaiting = true;
+    escDeadline = Clock::now() + escTimeout;
+    wakeAt(escDeadline);
+  }
+  return false;
+}
+
+void TermSession::setMouse(bool on) {
+#ifndef _WIN32
+  if (on == mouse)
+    return;
+  mouse = on;
+  // 1000 点击，1002 按住拖动，1006 SGR 编码（坐标不受 223 列限制）
+  writer.write(on ? "\033[?1000h\033[?1002h\033[?1006h"
+                  : "\033[?1006l\033[?1002l\033[?1000l");
+#endif
+}
+
+void TermSession::anchorStale() {
+  // 已发出的查询描述的是旧区域
+  anchorKnown = false;
+  cprIgnore = cprPending;
+}
+
+void TermSession::reserveRows(int rows) {
+  if (rows <= height)
+    return;
+  anchorStale();
+  // 光标停在区域最后一行，换行即可向下扩展（必要时滚屏）
+  TermFrame grow = frame();
+  grow << std::string(static_cast<size_t>(rows - height), '\n');
+  writer.write(grow.str());
+  height = rows;
+  shown.clear();
+}
+
+void TermSession::present(TermFrame &frame) {
+  frame.moveTo(TermCoord{0, static_cast<decltype(TermCoord::Y)>(height - 1)});
+  if (frame.str() != shown) {
+    shown = frame.str();
+    writer.frame(shown);
+  }
+
+  // 有序写入，跟在本帧之后：应答时光标必在区域最后一行
+  if (mouse && !anchorKnown && cprPending == cprIgnore) {
+    writer.write("\033[6n");
+    ++cprPending;
+  }
+}
+
+void TermSession::commit(TermFrame &frame) {
+  writer.write(frame.str());
+  committed += std::max(frame.cursorRow(), 0);
+  height = 1;
+  shown.clear();
+  anchorStale();
+}
+
+bool TermSession::reclaim(int rows) {
+  if (rows <= 0)
+    return rows == 0;
+  // 相对移动到不了屏幕顶端之上
+  if (rows > committed || rows + height > lines())
+    return false;
+  height += rows;
+  committed -= rows;
+  shown.clear();
+  anchorStale();
+  return true;
+}
@@ -0,0 +1,176 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <utility>
+
+#include "Arch/icli/profile_counters.h"
+#include "Arch/icli/term_writer.h"
+
+#define SYNC_BEGIN "\033[?2026h"
+#define SYNC_END "\033[?2026l"
+
+#ifdef _WIN32
+#include <windows.h>
+
+// Windows 控制台写入是同步的，这里只打开 VT 序列支持，不做跳帧
+TermWriter::TermWriter(int fd) : out(fd) {
+  std::cout.flush();
+  HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+  DWORD mode = 0;
+  if (GetConsoleMode(hOut, &mode))
+    SetConsoleMode(hOut, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+}
+
+TermWriter::~TermWriter() = default;
+
+void TermWriter::write(const std::string &bytes) {
+  std::string out = synchronized ? SYNC_BEGIN + bytes + SYNC_END : bytes;
+  profile_count(profile_counters().writes);
+  profile_count(profile_counters().writtenBytes, out.size());
+  fwrite(out.data(), 1, out.size(), stdout);
+  fflush(stdout);
+  if (observer)
+    observer(out.data(), out.size());
+}
+
+void TermWriter::frame(std::string bytes) { write(bytes); }
+
+bool TermWriter::pump() { return true; }
+
+bool TermWriter::flush(int) { return true; }
+
+#else  // POSIX
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+TermWriter::TermWriter(int fd) : out(fd) {
+  std::cout.flush();
+
+  // 不能直接给 fd 设 O_NONBLOCK：终端的 0/1/2 通常共享同一个打开描述，
+  // 会连带 stdin/stderr 以及父 shell 一起变成非阻塞。
+  // 对 tty 重新打开一个私有描述；管道和文件保持阻塞写。
+  if (isatty(fd)) {
+    const char *name = ttyname(fd);
+    int reopened = name ? open(name, O_WRONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC) : -1;
+    if (reopened >= 0) {
+      out = reopened;
+      owned = true;
+      nonblocking = true;
+    }
+  }
+
+  struct stat st;
+  socket = fstat(out, &st) == 0 && S_ISSOCK(st.st_mode);
+}
+
+TermWriter::~TermWriter() {
+  flush(closeTimeoutMs);
+  if (owned)
+    close(out);
+}
+
+void TermWriter::write(const std::string &bytes) {
+  // 未开始的帧先入队，保证顺序输出不会被旧帧覆盖
+  if (hasPending) {
+    queue += pendingFrame;
+    pendingFrame.clear();
+    hasPending = false;
+  }
+  if (synchronized)
+    queue += SYNC_BEGIN;
+  queue += bytes;
+  if (synchronized)
+    queue += SYNC_END;
+  pump();
+}
+
+void TermWriter::frame(std::string bytes) {
+  if (synchronized)
+    bytes = SYNC_BEGIN + bytes + SYNC_END;
+  if (offset < queue.size()) {
+    if (hasPending)
+      ++dropped;
+    pendingFrame = std::move(bytes);
+    hasPending = true;
+  } else {
+    queue = std::move(bytes);
+    offset = 0;
+  }
+  pump();
+}
+
+long TermWriter::send_bytes(const char *data, size_t len) {
+  // 包括返回 EAGAIN 的调用：它们同样是一次系统调用
+  profile_count(profile_counters().writes);
+#ifdef MSG_NOSIGNAL
+  // 对端断开的 socket 只应返回 EPIPE，不能让整个进程收到 SIGPIPE
+  if (socket)
+    return send(out, data, len, MSG_NOSIGNAL);
+#endif
+  return ::write(out, data, len);
+}
+
+bool TermWriter::pump() {
+  while (true) {
+    while (offset < queue.size()) {
+      ssize_t n = send_bytes(queue.data() + offset, queue.size() - offset);
+      if (n > 0) {
+        profile_count(profile_counters().writtenBytes, static_cast<uint64_t>(n));
+        if (observer)
+          observer(queue.data() + offset, static_cast<size_t>(n));
+        offset += static_cast<size_t>(n);
+      } else if (n < 0 && errno == EINTR) {
+        continue;
+      } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return false;
+      } else {
+        // 终端已关闭等不可恢复的错误：丢弃积压
+        discard();
+        return true;
+      }
+    }
+    queue.clear();
+    offset = 0;
+    if (!hasPending)
+      return true;
+    queue.swap(pendingFrame);
+    hasPending = false;
+  }
+}
+
+void TermWriter::discard() {
+  queue.clear();
+  offset = 0;
+  hasPending = false;
+  pendingFrame.clear();
+}
+
+bool TermWriter::flush(int timeout_ms) {
+  if (stalled)
+    timeout_ms = 0;
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point until =
+      Clock::now() + std::chrono::milliseconds(timeout_ms < 0 ? 0 : timeout_ms);
+  while (!pump()) {
+    int wait = -1;
+    if (timeout_ms >= 0) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          until - Clock::now()).count();
+      if (left <= 0) {
+        discard();
+        stalled = true;
+        return false;
+      }
+      wait = static_cast<int>(left);
+    }
+    struct pollfd pfd = {out, POLLOUT, 0};
+    poll(&pfd, 1, wait);
+  }
+  return true;
+}
+#endif